@@ -0,0 +1,61 @@
+#ifndef TRON_ADMIN_H
+#define TRON_ADMIN_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cerrno>
+#include <sys/socket.h>
+#include "config.h"
+
+// Local admin interface. Every room process listens on ADMIN_SOCKET_PATH
+// (workers add their suffix as for the other per-room files) and takes one
+// command per line, for example
+//   echo "set tick_ms 80" | nc -U /tmp/tron_admin.sock
+// Commands run in the main loop between ticks, under the room lock, so a
+// change lands exactly on a tick boundary. A reply is the command's output
+// followed by "OK" or "ERR <reason>" on a line of its own. The socket is
+// created owner-only; anyone who can open it can kick players and retune.
+namespace admin {
+
+struct Session {
+    int fd;
+    std::string input;
+};
+
+// Pulls whatever is readable; false once the peer is gone or floods us.
+inline bool readInput(Session& session) {
+    char buf[1024];
+    ssize_t n = recv(session.fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n <= 0) return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    session.input.append(buf, n);
+    return session.input.size() <= ADMIN_MAX_LINE;
+}
+
+inline bool nextLine(Session& session, std::string& line) {
+    size_t end = session.input.find('\n');
+    if (end == std::string::npos) return false;
+    line.assign(session.input, 0, end);
+    session.input.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+inline std::vector<std::string> split(const std::string& line) {
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string word;
+    while (in >> word) words.push_back(word);
+    return words;
+}
+
+// Never blocks the tick: a reply the socket cannot take in full fails and
+// the caller drops the session.
+inline bool reply(int fd, const std::string& text) {
+    return send(fd, text.data(), text.size(), MSG_DONTWAIT | MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(text.size());
+}
+
+}  // namespace admin
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TRON_ALLOC_STATS_H
+#define TRON_ALLOC_STATS_H
+
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+
+// Heap allocation counting for the game tick. Built with ALLOC_STATS=1 the
+// global operator new is replaced by one that bumps a per-thread counter, so a
+// room thread sees only its own allocations; otherwise allocCount() is always
+// 0 and the checks cost nothing. The replacement operators are defined here,
+// which is fine as long as each program includes this header from one file.
+#ifdef TRON_COUNT_ALLOCS
+
+inline uint64_t& threadAllocCount() {
+    static thread_local uint64_t count = 0;
+    return count;
+}
+
+inline uint64_t allocCount() { return threadAllocCount(); }
+
+void* operator new(size_t size) {
+    threadAllocCount()++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// GCC pairs the inlined malloc/free against new/delete and warns spuriously.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+#pragma GCC diagnostic pop
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+#else
+
+inline uint64_t allocCount() { return 0; }
+
+#endif
+
+// Allocations per tick, fed with the allocCount() difference across a tick.
+struct AllocStats {
+    uint64_t ticks = 0;
+    uint64_t allocatingTicks = 0;
+    uint64_t allocations = 0;
+    uint64_t maxPerTick = 0;
+
+    void record(uint64_t count) {
+        ticks++;
+        if (!count) return;
+        allocatingTicks++;
+        allocations += count;
+        if (count > maxPerTick) maxPerTick = count;
+    }
+};
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef TRON_BITBOARD_H
+#define TRON_BITBOARD_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Word-array kernels. AVX2 is used when the compiler targets it
+// (make ARCHFLAGS=-mavx2), SSE2 otherwise on x86-64, with a scalar fallback.
+namespace bitkernels {
+
+inline void andNotWords(uint64_t* dst, const uint64_t* mask, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_andnot_si256(m, d));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_andnot_si128(m, d));
+    }
+#endif
+    for (; i < n; i++) dst[i] &= ~mask[i];
+}
+
+inline void andWords(uint64_t* dst, const uint64_t* src, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(d, s));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(d, s));
+    }
+#endif
+    for (; i < n; i++) dst[i] &= src[i];
+}
+
+inline void orWords(uint64_t* dst, const uint64_t* src, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(d, s));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(d, s));
+    }
+#endif
+    for (; i < n; i++) dst[i] |= src[i];
+}
+
+// dst |= src & pass; returns whether any new bit was set in dst.
+inline bool spreadRow(uint64_t* dst, const uint64_t* src, const uint64_t* pass, size_t n) {
+    size_t i = 0;
+    bool changed = false;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i add = _mm256_andnot_si256(d, _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pass + i))));
+        if (!_mm256_testz_si256(add, add)) {
+            changed = true;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(d, add));
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i add = _mm_andnot_si128(d, _mm_and_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(pass + i))));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(add, _mm_setzero_si128())) != 0xFFFF) {
+            changed = true;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(d, add));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        uint64_t add = src[i] & pass[i] & ~dst[i];
+        if (add) {
+            changed = true;
+            dst[i] |= add;
+        }
+    }
+    return changed;
+}
+
+// Extends the set bits of row through every run of pass they touch
+// (Kogge-Stone fill in both directions, carried across words).
+inline void closeRow(uint64_t* row, const uint64_t* pass, size_t n) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t p = pass[i], g = (row[i] | carry) & p;
+        g |= p & (g << 1);  p &= p << 1;
+        g |= p & (g << 2);  p &= p << 2;
+        g |= p & (g << 4);  p &= p << 4;
+        g |= p & (g << 8);  p &= p << 8;
+        g |= p & (g << 16); p &= p << 16;
+        g |= p & (g << 32);
+        row[i] = g;
+        carry = g >> 63;
+    }
+    carry = 0;
+    for (size_t i = n; i-- > 0;) {
+        uint64_t p = pass[i], g = (row[i] | carry) & p;
+        g |= p & (g >> 1);  p &= p >> 1;
+        g |= p & (g >> 2);  p &= p >> 2;
+        g |= p & (g >> 4);  p &= p >> 4;
+        g |= p & (g >> 8);  p &= p >> 8;
+        g |= p & (g >> 16); p &= p >> 16;
+        g |= p & (g >> 32);
+        row[i] = g;
+        carry = (g & 1) << 63;
+    }
+}
+
+inline size_t popcountWords(const uint64_t* src, size_t n) {
+    size_t i = 0;
+    size_t total = 0;
+#if defined(__AVX2__)
+    // Nibble lookup popcount (Mula), summed per 64-bit lane with SAD.
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+        __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+                                                    _mm256_setzero_si256()));
+    }
+    total += _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+             _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+#elif defined(__SSE2__)
+    // No byte shuffle before SSSE3: SWAR bit sums per byte, then SAD.
+    const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33), m4 = _mm_set1_epi8(0x0F);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+        v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    total += lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) total += __builtin_popcountll(src[i]);
+    return total;
+}
+
+inline bool anyWords(const uint64_t* src, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (!_mm256_testz_si256(v, v)) return true;
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) return true;
+    }
+#endif
+    for (; i < n; i++) {
+        if (src[i]) return true;
+    }
+    return false;
+}
+
+}  // namespace bitkernels
+
+#if defined(__AVX2__)
+#define BITBOARD_VECTOR_WORDS 4
+#else
+#define BITBOARD_VECTOR_WORDS 2
+#endif
+
+// One bit per cell, rows padded to a whole number of vector registers.
+// Padding bits are always zero.
+class Bitboard {
+private:
+    std::vector<uint64_t> words;
+    int w = 0;
+    int h = 0;
+    int stride = 0;
+
+public:
+    Bitboard() = default;
+    Bitboard(int width, int height) { resize(width, height); }
+
+    void resize(int width, int height) {
+        w = width;
+        h = height;
+        stride = ((width + 63) / 64 + BITBOARD_VECTOR_WORDS - 1) & ~(BITBOARD_VECTOR_WORDS - 1);
+        words.assign(static_cast<size_t>(stride) * height, 0);
+    }
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int rowWords() const { return stride; }
+    size_t wordCount() const { return words.size(); }
+    uint64_t* data() { return words.data(); }
+    const uint64_t* data() const { return words.data(); }
+    uint64_t* row(int y) { return words.data() + static_cast<size_t>(y) * stride; }
+    const uint64_t* row(int y) const { return words.data() + static_cast<size_t>(y) * stride; }
+
+    bool test(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    void set(int x, int y) { row(y)[x >> 6] |= uint64_t(1) << (x & 63); }
+    void reset(int x, int y) { row(y)[x >> 6] &= ~(uint64_t(1) << (x & 63)); }
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+
+    size_t count() const { return bitkernels::popcountWords(words.data(), words.size()); }
+    bool any() const { return bitkernels::anyWords(words.data(), words.size()); }
+    void andNot(const Bitboard& mask) {
+        bitkernels::andNotWords(words.data(), mask.words.data(), words.size());
+    }
+    void andWith(const Bitboard& other) {
+        bitkernels::andWords(words.data(), other.words.data(), words.size());
+    }
+    void orWith(const Bitboard& other) {
+        bitkernels::orWords(words.data(), other.words.data(), words.size());
+    }
+
+    // Sets every in-range cell; the complement of an occupancy grid.
+    void fill() {
+        for (int y = 0; y < h; y++) {
+            uint64_t* r = row(y);
+            for (int i = 0; i < stride; i++) {
+                int bits = std::min(64, std::max(0, w - i * 64));
+                r[i] = bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1);
+            }
+        }
+    }
+
+    // True when no cell in [x0, x1] x [y0, y1] is set; the window is clipped to the board.
+    bool windowEmpty(int x0, int y0, int x1, int y1) const {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, w - 1);
+        y1 = std::min(y1, h - 1);
+        if (x0 > x1 || y0 > y1) return true;
+        int firstWord = x0 >> 6, lastWord = x1 >> 6;
+        for (int y = y0; y <= y1; y++) {
+            const uint64_t* r = row(y);
+            for (int i = firstWord; i <= lastWord; i++) {
+                uint64_t mask = ~uint64_t(0);
+                if (i == firstWord) mask &= ~uint64_t(0) << (x0 & 63);
+                if (i == lastWord && (x1 & 63) != 63) mask &= (uint64_t(1) << ((x1 & 63) + 1)) - 1;
+                if (r[i] & mask) return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename F>
+    void forEachSet(F&& f) const {
+        for (int y = 0; y < h; y++) {
+            const uint64_t* r = row(y);
+            for (int i = 0; i < stride; i++) {
+                uint64_t bits = r[i];
+                while (bits) {
+                    f(i * 64 + __builtin_ctzll(bits), y);
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+};
+
+// Word-parallel flood fill. Scratch boards are reused across calls; one
+// instance per thread.
+class BitboardFlood {
+private:
+    Bitboard region;
+    std::vector<int> pendingRows;
+    std::vector<char> rowQueued;
+
+public:
+    // Cells reachable from (x, y) through pass, capped at limit. Scanline fill
+    // at word width: each row is closed horizontally in one pass, and only rows
+    // that gained cells push into their neighbours.
+    int reachableArea(int x, int y, const Bitboard& pass, int limit) {
+        if (region.width() != pass.width() || region.height() != pass.height()) {
+            region.resize(pass.width(), pass.height());
+        }
+        if (!pass.test(x, y)) return 0;
+        size_t n = pass.rowWords();
+        int h = pass.height();
+        region.clear();
+        rowQueued.assign(h, 0);
+        pendingRows.clear();
+
+        region.set(x, y);
+        bitkernels::closeRow(region.row(y), pass.row(y), n);
+        pendingRows.push_back(y);
+        rowQueued[y] = 1;
+        while (!pendingRows.empty()) {
+            int r = pendingRows.back();
+            pendingRows.pop_back();
+            rowQueued[r] = 0;
+            for (int nr = r - 1; nr <= r + 1; nr += 2) {
+                if (nr < 0 || nr >= h) continue;
+                if (!bitkernels::spreadRow(region.row(nr), region.row(r), pass.row(nr), n)) continue;
+                bitkernels::closeRow(region.row(nr), pass.row(nr), n);
+                if (!rowQueued[nr]) {
+                    rowQueued[nr] = 1;
+                    pendingRows.push_back(nr);
+                }
+            }
+        }
+        return std::min(static_cast<int>(region.count()), limit);
+    }
+};
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef TRON_BOT_H
+#define TRON_BOT_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "config.h"
+#include "bitboard.h"
+
+struct BotHead {
+    int x, y;
+    int value;      // board value of this player's trail (colorIndex + 1)
+};
+
+// Evaluators take the room's rules (see tron_sim.h): under Rules::Self a
+// player's own trail is either crossable or as deadly as anyone's, and
+// Rules::Edges decides whether the board wraps.
+
+// Flat-grid evaluator shared by every bot in a room. The board is loaded once
+// per tick; each evaluation is a single BFS over preallocated buffers, with
+// generation stamps so nothing is cleared between searches.
+template <class Rules>
+class TerritoryEvaluator {
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<int> cells;
+    std::vector<uint32_t> seen;
+    std::vector<int> dist;
+    std::vector<int> owner;
+    std::vector<int> queue;
+    uint32_t generation = 0;
+
+    static constexpr int CONTESTED = -1;
+
+    bool passable(int index, int value) const {
+        if constexpr (Rules::Self::collides) return cells[index] == 0;
+        return cells[index] == 0 || cells[index] == value;
+    }
+
+    // Up, down, left and right of cur; -1 past a wall.
+    void neighbours(int cur, int next[4]) const {
+        int cx = cur % width, cy = cur / width;
+        if constexpr (Rules::Edges::wraps) {
+            next[0] = cy > 0 ? cur - width : cur + (height - 1) * width;
+            next[1] = cy < height - 1 ? cur + width : cx;
+            next[2] = cx > 0 ? cur - 1 : cur + width - 1;
+            next[3] = cx < width - 1 ? cur + 1 : cur - cx;
+        } else {
+            next[0] = cy > 0 ? cur - width : -1;
+            next[1] = cy < height - 1 ? cur + width : -1;
+            next[2] = cx > 0 ? cur - 1 : -1;
+            next[3] = cx < width - 1 ? cur + 1 : -1;
+        }
+    }
+
+    uint32_t nextGeneration() {
+        if (++generation == 0) {
+            std::fill(seen.begin(), seen.end(), 0);
+            generation = 1;
+        }
+        return generation;
+    }
+
+public:
+    static constexpr bool scoresTerritory = true;
+
+    void load(const int* board, int w, int h) {
+        width = w;
+        height = h;
+        size_t size = static_cast<size_t>(w) * h;
+        if (cells.size() != size) {
+            cells.assign(size, 0);
+            seen.assign(size, 0);
+            dist.assign(size, 0);
+            owner.assign(size, 0);
+            queue.assign(size, 0);
+            generation = 0;
+        }
+        std::copy(board, board + size, cells.begin());
+    }
+
+    bool isOpen(int x, int y, int value) const {
+        return x >= 0 && x < width && y >= 0 && y < height && passable(y * width + x, value);
+    }
+
+    // A step onto (x, y): wraps it onto the board where the rules do, then
+    // says whether it can be taken.
+    bool enter(int& x, int& y, int value) const {
+        if constexpr (Rules::Edges::wraps) {
+            x = (x + width) % width;
+            y = (y + height) % height;
+        }
+        return isOpen(x, y, value);
+    }
+
+    // Number of cells reachable from (x, y), stopping early at limit.
+    int reachableArea(int x, int y, int value, int limit) {
+        if (!isOpen(x, y, value)) return 0;
+        uint32_t gen = nextGeneration();
+        int qHead = 0, qTail = 0;
+        int start = y * width + x;
+        seen[start] = gen;
+        queue[qTail++] = start;
+        while (qHead < qTail && qTail < limit) {
+            int cur = queue[qHead++];
+            int next[4];
+            neighbours(cur, next);
+            for (int n : next) {
+                if (n < 0 || seen[n] == gen || !passable(n, value)) continue;
+                seen[n] = gen;
+                queue[qTail++] = n;
+            }
+        }
+        return qTail;
+    }
+
+    // Voronoi partition by simultaneous BFS from every head. Returns the number
+    // of cells heads[self] reaches strictly before any other head.
+    int voronoiTerritory(const BotHead* heads, int headCount, int self) {
+        uint32_t gen = nextGeneration();
+        int qHead = 0, qTail = 0;
+        for (int i = 0; i < headCount; i++) {
+            const BotHead& h = heads[i];
+            if (h.x < 0 || h.x >= width || h.y < 0 || h.y >= height) continue;
+            int index = h.y * width + h.x;
+            if (seen[index] == gen) {
+                owner[index] = CONTESTED;
+                continue;
+            }
+            seen[index] = gen;
+            dist[index] = 0;
+            owner[index] = i;
+            queue[qTail++] = index;
+        }
+
+        int territory = 0;
+        while (qHead < qTail) {
+            int cur = queue[qHead++];
+            int who = owner[cur];
+            if (who == CONTESTED) continue;
+            if (who == self) territory++;
+            int next[4];
+            neighbours(cur, next);
+            for (int n : next) {
+                if (n < 0 || !passable(n, heads[who].value)) continue;
+                if (seen[n] != gen) {
+                    seen[n] = gen;
+                    dist[n] = dist[cur] + 1;
+                    owner[n] = who;
+                    queue[qTail++] = n;
+                } else if (dist[n] == dist[cur] + 1 && owner[n] != who) {
+                    owner[n] = CONTESTED;
+                }
+            }
+        }
+        return territory;
+    }
+};
+
+// Reachable-area half of TerritoryEvaluator, built on the room's bitboards: a
+// player may cross empty cells and, unless its own trail kills, that trail,
+// so its passable set is ~occupied | owner[player]. Searches run at word
+// width and stop at the board edges; wrapping rules use the cell BFS. There
+// is no territory search: a word-parallel Voronoi lost to the cell BFS at
+// these board sizes.
+template <class Rules>
+class BitboardEvaluator {
+private:
+    Bitboard pass[MAX_PLAYERS + 1];
+    BitboardFlood flood;
+    int width = 0;
+    int height = 0;
+
+public:
+    static constexpr bool scoresTerritory = false;
+
+    void load(const Bitboard& occupied, const Bitboard* owners, int ownerCount) {
+        width = occupied.width();
+        height = occupied.height();
+        for (int v = 1; v <= ownerCount && v <= MAX_PLAYERS; v++) {
+            Bitboard& p = pass[v];
+            if (p.width() != width || p.height() != height) p.resize(width, height);
+            p.fill();
+            p.andNot(occupied);
+            if constexpr (!Rules::Self::collides) p.orWith(owners[v - 1]);
+        }
+    }
+
+    bool isOpen(int x, int y, int value) const {
+        return x >= 0 && x < width && y >= 0 && y < height && pass[value].test(x, y);
+    }
+
+    bool enter(int& x, int& y, int value) const {
+        return isOpen(x, y, value);
+    }
+
+    int reachableArea(int x, int y, int value, int limit) {
+        if (!isOpen(x, y, value)) return 0;
+        return flood.reachableArea(x, y, pass[value], limit);
+    }
+};
+
+// Depth-limited lookahead over the bot's own moves, with the other heads held
+// in place. Depth 1 scores moves by reachable area only; deeper levels score
+// leaves by Voronoi territory. Cost is at most 3^depth BFS passes per bot.
+template <typename Evaluator>
+class BotPlanner {
+private:
+    Evaluator& eval;
+    std::vector<BotHead> heads;
+    int self = 0;
+
+    static constexpr int DEAD = -1000000;
+
+    int evaluate(int level) {
+        const BotHead& me = heads[self];
+        if constexpr (Evaluator::scoresTerritory) {
+            if (level > 1) {
+                return eval.voronoiTerritory(heads.data(), static_cast<int>(heads.size()), self);
+            }
+        }
+        return eval.reachableArea(me.x, me.y, me.value, BOT_AREA_LIMIT);
+    }
+
+    int search(int dx, int dy, int depth, int level) {
+        static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+        BotHead& me = heads[self];
+        int best = DEAD;
+        for (const auto& d : dirs) {
+            if (d[0] == -dx && d[1] == -dy) continue;
+            int nx = me.x + d[0], ny = me.y + d[1];
+            if (!eval.enter(nx, ny, me.value)) continue;
+            int px = me.x, py = me.y;
+            me.x = nx;
+            me.y = ny;
+            int score = depth <= 1 ? evaluate(level) : search(d[0], d[1], depth - 1, level);
+            me.x = px;
+            me.y = py;
+            if (score > best) best = score;
+        }
+        return best;
+    }
+
+public:
+    explicit BotPlanner(Evaluator& evaluator) : eval(evaluator) {}
+
+    void setHeads(const std::vector<BotHead>& allHeads, int selfIndex) {
+        heads = allHeads;
+        self = selfIndex;
+    }
+
+    // Returns the key (KEY_UP/DOWN/LEFT/RIGHT) for the best move, or 0 to keep
+    // the current heading, which also wins ties.
+    char chooseMove(int dx, int dy, int level) {
+        struct Option { int dx, dy; char key; };
+        const Option options[5] = {{dx, dy, 0}, {0, -1, KEY_UP}, {0, 1, KEY_DOWN},
+                                   {-1, 0, KEY_LEFT}, {1, 0, KEY_RIGHT}};
+        BotHead& me = heads[self];
+        int depth = level < 1 ? 1 : (level > BOT_MAX_DEPTH ? BOT_MAX_DEPTH : level);
+
+        int bestScore = DEAD - 1;
+        char bestKey = 0;
+        for (int i = 0; i < 5; i++) {
+            const Option& o = options[i];
+            if (i > 0 && o.dx == dx && o.dy == dy) continue;
+            if (o.dx == -dx && o.dy == -dy) continue;
+            int nx = me.x + o.dx, ny = me.y + o.dy;
+            if (!eval.enter(nx, ny, me.value)) continue;
+            int px = me.x, py = me.y;
+            me.x = nx;
+            me.y = ny;
+            int score = depth <= 1 ? evaluate(level) : search(o.dx, o.dy, depth - 1, level);
+            me.x = px;
+            me.y = py;
+            if (score > bestScore) {
+                bestScore = score;
+                bestKey = o.key;
+            }
+        }
+        return bestKey;
+    }
+};
+
+#endif
@@ -1,20 +1,35 @@
 #include <map>          
 #include <string>       
 #include <cstring>      
-#include <thread>       
+#include <cstdlib>      
+#include <algorithm>    
 #include <vector>       
 #include <atomic>       
+#include <random>       
+#include <chrono>       
 #include <codecvt>      
 #include <sstream>      
 #include <fcntl.h>      
 #include <iostream>     
 #include <unistd.h>     
 #include <locale.h>     
+#include <langinfo.h>
 #include <termios.h>    
+#include <csignal>      
+#include <sys/ioctl.h>  
+#include <poll.h>       
 #include <arpa/inet.h>  
 #include <sys/socket.h> 
 #include <netinet/in.h> 
+#include <sys/un.h>     
 #include "config.h"     
+#include "protocol.h"   
+#include "udp_transport.h"
+#include "shm_ring.h"
+#include "viewport.h"
+#include "terminal_input.h"
+#include "latency.h"
+#include "state_hash.h"
 
 #ifdef DEBUG_MODE
 #define DEBUG_LOG(msg, ...) printf("[DEBUG] " msg "\n", ##__VA_ARGS__)
@@ -22,28 +37,26 @@
 #define DEBUG_LOG(msg, ...)
 #endif
 
-void clearScreen() {
-    std::cout << "\033[2J\033[H";
+std::atomic<bool> terminalResized{true};
+
+void onWindowChange(int) {
+    terminalResized = true;
 }
 
-char getch() {
-    char buf = 0;
-    struct termios old = {0};
-    if (tcgetattr(0, &old) < 0)
-        perror("tcsetattr()");
-    old.c_lflag &= ~ICANON;
-    old.c_lflag &= ~ECHO;
-    old.c_cc[VMIN] = 1;
-    old.c_cc[VTIME] = 0;
-    if (tcsetattr(0, TCSANOW, &old) < 0)
-        perror("tcsetattr ICANON");
-    if (read(0, &buf, 1) < 0)
-        perror("read()");
-    old.c_lflag |= ICANON;
-    old.c_lflag |= ECHO;
-    if (tcsetattr(0, TCSADRAIN, &old) < 0)
-        perror("tcsetattr ~ICANON");
-    return buf;
+// Board cells that fit in the terminal after the title, borders, footer and
+// minimap. Returns false when stdout is not a terminal.
+bool terminalViewport(int& cols, int& rows) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) < 0 || ws.ws_col == 0 || ws.ws_row == 0) {
+        return false;
+    }
+    cols = ws.ws_col - 2;
+    rows = ws.ws_row - 7 - MINIMAP_HEIGHT;
+    return true;
+}
+
+void clearScreen() {
+    std::cout << "\033[2J\033[H";
 }
 
 std::string wstrToStr(const wchar_t* wstr) {
@@ -73,95 +86,100 @@ std::string wstrToStr(const wchar_t* wstr) {
     return result;
 }
 
-std::string addBorder(const std::string& boardStr) {
-    std::string result;
-    std::vector<std::string> rows;
-    std::string row;
-    std::stringstream ss(boardStr);
-    std::string line;
-
-    if (std::getline(ss, line)) {
-        result += COLOR_WHITE;
-        result += wstrToStr(WALL_TOP_LEFT);
-        
-        std::string scoreInfo = line;
-        size_t startEsc = scoreInfo.find("\033[");
-        while (startEsc != std::string::npos) {
-            size_t endEsc = scoreInfo.find('m', startEsc);
-            if (endEsc != std::string::npos) {
-                scoreInfo.erase(startEsc, endEsc - startEsc + 1);
-            }
-            startEsc = scoreInfo.find("\033[");
-        }
+// How the board is drawn. UTF-8 glyphs take three bytes a cell and colors an
+// escape per change, which adds up on serial consoles and thin SSH links;
+// ASCII glyphs are one byte, and without color trails show the player's
+// number so players stay apart. Detected from the locale and TERM, or forced
+// with --ascii / --mono.
+struct RenderStyle {
+    bool color = true;
+    bool ascii = false;
+    std::string up, down, left, right;
+    std::string horizontal, vertical;
+    std::string cornerLeftUp, cornerLeftDown, cornerRightDown, cornerRightUp;
+    std::string wallHorizontal, wallVertical;
+    std::string wallTopLeft, wallTopRight, wallBottomLeft, wallBottomRight;
+};
 
-        while (!scoreInfo.empty() && (scoreInfo.back() == '\n' || scoreInfo.back() == '\r')) {
-            scoreInfo.pop_back();
-        }
+RenderStyle makeRenderStyle(bool ascii, bool color) {
+    RenderStyle s;
+    s.ascii = ascii;
+    s.color = color;
+    if (ascii) {
+        s.up = ASCII_PLAYER_UP;
+        s.down = ASCII_PLAYER_DOWN;
+        s.left = ASCII_PLAYER_LEFT;
+        s.right = ASCII_PLAYER_RIGHT;
+        s.horizontal = ASCII_TRAIL_HORIZONTAL;
+        s.vertical = ASCII_TRAIL_VERTICAL;
+        s.cornerLeftUp = s.cornerLeftDown = s.cornerRightDown = s.cornerRightUp = ASCII_TRAIL_CORNER;
+        s.wallHorizontal = s.wallVertical = ASCII_WALL;
+        s.wallTopLeft = s.wallTopRight = s.wallBottomLeft = s.wallBottomRight = ASCII_WALL;
+        return s;
+    }
+    s.up = wstrToStr(PLAYER_UP);
+    s.down = wstrToStr(PLAYER_DOWN);
+    s.left = wstrToStr(PLAYER_LEFT);
+    s.right = wstrToStr(PLAYER_RIGHT);
+    s.horizontal = wstrToStr(TRAIL_HORIZONTAL);
+    s.vertical = wstrToStr(TRAIL_VERTICAL);
+    s.cornerLeftUp = wstrToStr(TRAIL_CORNER_LEFT_UP);
+    s.cornerLeftDown = wstrToStr(TRAIL_CORNER_LEFT_DOWN);
+    s.cornerRightDown = wstrToStr(TRAIL_CORNER_RIGHT_DOWN);
+    s.cornerRightUp = wstrToStr(TRAIL_CORNER_RIGHT_UP);
+    s.wallHorizontal = wstrToStr(WALL_HORIZONTAL);
+    s.wallVertical = wstrToStr(WALL_VERTICAL);
+    s.wallTopLeft = wstrToStr(WALL_TOP_LEFT);
+    s.wallTopRight = wstrToStr(WALL_TOP_RIGHT);
+    s.wallBottomLeft = wstrToStr(WALL_BOTTOM_LEFT);
+    s.wallBottomRight = wstrToStr(WALL_BOTTOM_RIGHT);
+    return s;
+}
 
-        if (scoreInfo.length() > BOARD_WIDTH) {
-            scoreInfo = scoreInfo.substr(0, BOARD_WIDTH);
-        }
+// Call after setlocale(). A non-UTF-8 codeset gets ASCII; a dumb, vt-class
+// or missing TERM, or NO_COLOR, gets no color.
+RenderStyle detectRenderStyle(bool forceAscii, bool forceMono) {
+    const char* codeset = nl_langinfo(CODESET);
+    bool ascii = forceAscii || !codeset || strcmp(codeset, "UTF-8") != 0;
+    const char* term = getenv("TERM");
+    bool color = !forceMono && term && *term && strcmp(term, "dumb") != 0 && 
+                 strncmp(term, "vt", 2) != 0 && !getenv("NO_COLOR");
+    return makeRenderStyle(ascii, color);
+}
 
-        result += scoreInfo;
-        
-        int padding = BOARD_WIDTH - scoreInfo.length();
-        if (padding > 0) {
-            for (int i = 0; i < padding; i++) {
-                result += wstrToStr(WALL_HORIZONTAL);
-            }
-        }
-        
-        result += wstrToStr(WALL_TOP_RIGHT);
-        result += COLOR_RESET + "\n";
-    }
+// Writes glyphs and emits a color escape only where the color changes.
+// Spaces keep the current color since it does not show on them; end() resets
+// so nothing bleeds past the line.
+class SpanWriter {
+private:
+    std::string& out;
+    bool enabled;
+    std::string current;
 
-    while (std::getline(ss, line)) {
-        if (line.empty()) continue;
-        if (line.find(GAME_FOOTER) != std::string::npos) {
-            rows.push_back(line);
-            continue;
-        }
-        rows.push_back(line);
-    }
-
-    for (size_t i = 0; i < BOARD_HEIGHT; i++) {
-        result += COLOR_WHITE + wstrToStr(WALL_VERTICAL) + COLOR_RESET;
-        if (i < rows.size()) {
-            result += rows[i];
-            int lineLength = 0;
-            size_t pos = 0;
-            while (pos < rows[i].length()) {
-                if (rows[i][pos] == '\033') {
-                    while (pos < rows[i].length() && rows[i][pos] != 'm') pos++;
-                    pos++;
-                    continue;
-                }
-                lineLength++;
-                pos++;
-            }
-            if (lineLength < BOARD_WIDTH) {
-                result.append(BOARD_WIDTH - lineLength, ' ');
-            }
-        } else {
-            result.append(BOARD_WIDTH, ' ');
+public:
+    SpanWriter(std::string& target, bool color) : out(target), enabled(color) {}
+
+    void put(const std::string& color, const std::string& glyph) {
+        if (enabled && color != current) {
+            out += color;
+            current = color;
         }
-        result += COLOR_WHITE + wstrToStr(WALL_VERTICAL) + COLOR_RESET + "\n";
+        out += glyph;
     }
 
-    result += COLOR_WHITE;
-    result += wstrToStr(WALL_BOTTOM_LEFT);
-    for (size_t i = 0; i < BOARD_WIDTH; i++) {
-        result += wstrToStr(WALL_HORIZONTAL);
-    }
-    result += wstrToStr(WALL_BOTTOM_RIGHT);
-    result += COLOR_RESET + "\n";
+    void blank(int count = 1) { out.append(count, ' '); }
 
-    if (!rows.empty() && rows.back().find(GAME_FOOTER) != std::string::npos) {
-        result += "\n" + rows.back();
+    // In the terminal's default color.
+    void plain(const char* glyph) {
+        end();
+        out += glyph;
     }
 
-    return result;
-}
+    void end() {
+        if (!current.empty()) out += COLOR_RESET;
+        current.clear();
+    }
+};
 
 struct PlayerState {
     int playerIndex;   
@@ -169,6 +187,7 @@ struct PlayerState {
     int score;         
     int highScore;     
     bool alive;        
+    int rank;          // leaderboard rank, 0 = not ranked
 };
 
 class GameDisplay {
@@ -179,30 +198,89 @@ private:
     const std::string playerColors[4] = {PLAYER_COLORS};  			
     int myPlayerIndex = -1;                  						
     int myColorIndex = -1;                   						
+    int regionX = 0, regionY = 0;                                   // board window the server sent
+    int regionW = BOARD_WIDTH, regionH = BOARD_HEIGHT;
+    int arenaW = BOARD_WIDTH, arenaH = BOARD_HEIGHT;
+    int viewCols = BOARD_WIDTH, viewRows = BOARD_HEIGHT;            // camera size
+    int minimapW = 0, minimapH = 0;
+    std::vector<int> minimap;
+    uint32_t tick = 0;                                              // tick of the state shown
+    int ranked = 0;                                                 // players on the leaderboard
+    int rankScope = 0;                                              // worker + 1 if ranks are per worker
+    uint64_t stampedBoardHash = 0;                                  // from the frame's HASH line
+    bool haveHash = false;
+    uint64_t desyncs = 0;                                           // frames whose board did not match
+    std::string link = "-";                                         // RTT/jitter/loss summary
+    const RenderStyle& style;
+    const std::string playerDigits[4] = {"1", "2", "3", "4"};       // trails without color
+    const std::string wallColor = COLOR_WHITE;
     int socket;                              						
 
-    std::string getTrailSymbol(int playerIndex, int x, int y) {
-        bool up = (y > 0 && board[y-1][x] == playerIndex);
-        bool down = (y < board.size()-1 && board[y+1][x] == playerIndex);
-        bool left = (x > 0 && board[y][x-1] == playerIndex);
-        bool right = (x < board[y].size()-1 && board[y][x+1] == playerIndex);
+    // Arena coordinates; cells outside the received window read as empty.
+    int cellAt(int x, int y) const {
+        x -= regionX;
+        y -= regionY;
+        if (x < 0 || y < 0 || x >= regionW || y >= regionH) return 0;
+        return board[y][x];
+    }
+
+    // Expands one "value," / "value*count," row into out[0..width).
+    static void parseRow(const std::string& line, int* out, int width) {
+        const char* p = line.c_str();
+        int col = 0;
+        while (*p && col < width) {
+            char* end;
+            int value = static_cast<int>(strtol(p, &end, 10));
+            int run = 1;
+            if (*end == '*') run = static_cast<int>(strtol(end + 1, &end, 10));
+            if (end == p || run < 1) break;
+            if (run > width - col) run = width - col;
+            std::fill_n(out + col, run, value);
+            col += run;
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    // A full-board frame must hash to what the server stamped; a mismatch means
+    // the frame was mangled between the simulation and here (codecs, parsing).
+    void checkBoardHash() {
+        if (!haveHash || regionW != arenaW || regionH != arenaH) return;
+        uint64_t h = 0;
+        for (int y = 0; y < regionH; y++) {
+            for (int x = 0; x < regionW; x++) {
+                h ^= zobristCell(static_cast<size_t>(y) * regionW + x, board[y][x]);
+            }
+        }
+        if (h != stampedBoardHash) {
+            desyncs++;
+            DEBUG_LOG("Board hash mismatch at tick %u (%llu so far)", tick,
+                      (unsigned long long)desyncs);
+        }
+    }
+
+    const std::string& getTrailSymbol(int playerIndex, int x, int y) {
+        if (!style.color) return playerDigits[playerIndex - 1];
+        bool up = cellAt(x, y - 1) == playerIndex;
+        bool down = cellAt(x, y + 1) == playerIndex;
+        bool left = cellAt(x - 1, y) == playerIndex;
+        bool right = cellAt(x + 1, y) == playerIndex;
         
-        if ((up || down) && !left && !right) return wstrToStr(TRAIL_VERTICAL);
-        if (!up && !down && (left || right)) return wstrToStr(TRAIL_HORIZONTAL);
-        if (up && right) return wstrToStr(TRAIL_CORNER_LEFT_DOWN);
-        if (up && left) return wstrToStr(TRAIL_CORNER_RIGHT_DOWN);
-        if (down && right) return wstrToStr(TRAIL_CORNER_LEFT_UP);
-        if (down && left) return wstrToStr(TRAIL_CORNER_RIGHT_UP);
+        if ((up || down) && !left && !right) return style.vertical;
+        if (!up && !down && (left || right)) return style.horizontal;
+        if (up && right) return style.cornerLeftDown;
+        if (up && left) return style.cornerRightDown;
+        if (down && right) return style.cornerLeftUp;
+        if (down && left) return style.cornerRightUp;
         
-        return wstrToStr(TRAIL_HORIZONTAL);  
+        return style.horizontal;  
     }
 
-    std::string getDirectionSymbol(int dx, int dy) {
-        if (dy < 0) return wstrToStr(PLAYER_UP);      
-        if (dy > 0) return wstrToStr(PLAYER_DOWN);    
-        if (dx < 0) return wstrToStr(PLAYER_LEFT);    
-        if (dx > 0) return wstrToStr(PLAYER_RIGHT);   
-        return wstrToStr(PLAYER_RIGHT);  				
+    const std::string& getDirectionSymbol(int dx, int dy) {
+        if (dy < 0) return style.up;      
+        if (dy > 0) return style.down;    
+        if (dx < 0) return style.left;    
+        if (dx > 0) return style.right;   
+        return style.right;  				
     }
 
     bool isPlayerHead(int x, int y, int colorIndex) {
@@ -215,10 +293,11 @@ private:
     }
 
 public:
-    GameDisplay(int sock) : 
+    GameDisplay(int sock, const RenderStyle& renderStyle) : 
         players(),
         playerPositions(),
         board(BOARD_HEIGHT, std::vector<int>(BOARD_WIDTH, 0)),
+        style(renderStyle),
         socket(sock) {}
 
     void setMyIndices(int pIndex, int cIndex) {
@@ -228,11 +307,32 @@ public:
         DEBUG_LOG("Set indices - player: %d, color: %d", pIndex, cIndex);
     }
 
+    // Camera size in board cells, from the terminal size.
+    void setViewport(int cols, int rows) {
+        viewCols = std::max(cols, VIEWPORT_MIN_COLS);
+        viewRows = std::max(rows, VIEWPORT_MIN_ROWS);
+    }
+
+    int cameraWidth() const { return std::min(viewCols, arenaW); }
+    int cameraHeight() const { return std::min(viewRows, arenaH); }
+    uint32_t seenTick() const { return tick; }
+
+    void setLinkStats(const LinkStats& stats) {
+        char text[48];
+        snprintf(text, sizeof(text), "%.0fms ~%.0f %.0f%%", 
+                 stats.rttMs, stats.jitterMs, stats.lossPct);
+        link = stats.samples ? text : "-";
+    }
+
     void updateState(const std::string& stateStr) {
         try {
             players.clear();
             playerPositions.clear();
-            board = std::vector<std::vector<int>>(BOARD_HEIGHT, std::vector<int>(BOARD_WIDTH, 0));
+            regionX = regionY = 0;
+            regionW = arenaW = BOARD_WIDTH;
+            regionH = arenaH = BOARD_HEIGHT;
+            minimapW = minimapH = 0;
+            haveHash = false;
             
             std::stringstream ss(stateStr);
             std::string line;
@@ -243,7 +343,24 @@ public:
                     foundPlayers = true;
                     break;
                 }
+                if (line.compare(0, 5, "TICK:") == 0) {
+                    tick = static_cast<uint32_t>(strtoull(line.c_str() + 5, nullptr, 10));
+                }
+                if (line.compare(0, 5, "HASH:") == 0) {
+                    const char* comma = strchr(line.c_str(), ',');
+                    haveHash = comma != nullptr;
+                    if (haveHash) stampedBoardHash = strtoull(comma + 1, nullptr, 16);
+                }
+                if (line.compare(0, 7, "RANKED:") == 0) {
+                    rankScope = 0;
+                    sscanf(line.c_str() + 7, "%d,%d", &ranked, &rankScope);
+                }
+                if (line.compare(0, 5, "VIEW:") == 0) {
+                    sscanf(line.c_str() + 5, "%d,%d,%d,%d,%d,%d", &regionX, &regionY,
+                           &regionW, &regionH, &arenaW, &arenaH);
+                }
             }
+            board.assign(regionH, std::vector<int>(regionW, 0));
             
             if (!foundPlayers) return;
 
@@ -275,6 +392,7 @@ public:
                     p.score = values[1];
                     p.highScore = values[2];
                     p.alive = values[3] != 0;
+                    p.rank = values.size() >= 9 ? values[8] : 0;
                     
                     players.push_back(p);
                     
@@ -285,30 +403,33 @@ public:
                 }
             }
 
+            // Cells are "value," or, from RLE-capable servers, "value*count,".
+            // Runs are expanded straight into the board row.
             int row = 0;
-            while (std::getline(ss, line) && line != "END" && row < BOARD_HEIGHT) {
+            while (row < regionH && std::getline(ss, line) && line != "END") {
                 if (line.empty()) continue;
-                
-                std::stringstream ls(line);
-                std::string value;
-                int col = 0;
-                
-                while (std::getline(ls, value, ',') && col < BOARD_WIDTH) {
-                    if (!value.empty()) {
-                        board[row][col] = std::stoi(value);
-                    }
-                    col++;
-                }
+                parseRow(line, board[row].data(), regionW);
                 row++;
             }
+
+            checkBoardHash();
+
+            if (std::getline(ss, line) && line.compare(0, 8, "MINIMAP:") == 0 &&
+                sscanf(line.c_str() + 8, "%d,%d", &minimapW, &minimapH) == 2) {
+                minimap.assign(static_cast<size_t>(minimapW) * minimapH, 0);
+                for (int y = 0; y < minimapH && std::getline(ss, line); y++) {
+                    parseRow(line, &minimap[y * minimapW], minimapW);
+                }
+            }
         } catch (const std::exception& e) {
             std::cerr << "Error updating state: " << e.what() << std::endl;
         }
     }
 
+    // The bordered board with the score line set into the top wall.
     std::string render() {
         std::string display;
-        char scoreBuffer[100]; 
+        char scoreBuffer[160]; 
         const PlayerState* currentPlayer = nullptr;
         int maxScore = 0;
         
@@ -321,155 +442,543 @@ public:
             }
         }
 
+        std::string scoreInfo;                // spectators: plain top border
         if (currentPlayer) {
+            std::string rank = currentPlayer->rank 
+                             ? "#" + std::to_string(currentPlayer->rank) + "/" + std::to_string(ranked)
+                             : "-";
+            if (rankScope) rank += " (w" + std::to_string(rankScope - 1) + ")";
             snprintf(scoreBuffer, sizeof(scoreBuffer), GAME_HEADER_FORMAT,
-                    currentPlayer->score, currentPlayer->highScore, maxScore);
-            display = std::string(scoreBuffer) + "\n";  
+                    currentPlayer->score, currentPlayer->highScore, maxScore, rank.c_str(),
+                    link.c_str());
+            scoreInfo = scoreBuffer;
         }
 
-        for (size_t y = 0; y < board.size(); ++y) {
-            for (size_t x = 0; x < board[y].size(); ++x) {
-                int colorIndex = board[y][x] - 1; 
-                if (colorIndex >= 0) {
-                    if (colorIndex < MAX_PLAYERS) {
-                        display += playerColors[colorIndex];
-                        if (isPlayerHead(x, y, colorIndex)) {
-                            auto it = playerPositions.find(colorIndex);
-                            if (it != playerPositions.end()) {
-                                auto [_, __, dx, dy] = it->second;
-                                display += getDirectionSymbol(dx, dy);
-                            }
-                        } else {
-                            display += getTrailSymbol(colorIndex + 1, x, y);
-                        }
-                        display += COLOR_RESET;
-                    }
+        // The camera follows our head and stops at the arena edges.
+        int camW = cameraWidth(), camH = cameraHeight();
+        int cx = regionX + regionW / 2, cy = regionY + regionH / 2;
+        auto me = playerPositions.find(myColorIndex);
+        if (me != playerPositions.end()) {
+            cx = std::get<0>(me->second);
+            cy = std::get<1>(me->second);
+        }
+        int camX = std::max(0, std::min(cx - camW / 2, arenaW - camW));
+        int camY = std::max(0, std::min(cy - camH / 2, arenaH - camH));
+
+        SpanWriter out(display, style.color);
+        if (static_cast<int>(scoreInfo.size()) > camW) scoreInfo.resize(camW);
+        out.put(wallColor, style.wallTopLeft);
+        display += scoreInfo;
+        for (int i = static_cast<int>(scoreInfo.size()); i < camW; i++) {
+            display += style.wallHorizontal;
+        }
+        display += style.wallTopRight;
+        out.end();
+        display += "\n";
+
+        for (int y = camY; y < camY + camH; ++y) {
+            out.put(wallColor, style.wallVertical);
+            for (int x = camX; x < camX + camW; ++x) {
+                int colorIndex = cellAt(x, y) - 1; 
+                if (colorIndex < 0 || colorIndex >= MAX_PLAYERS) {
+                    out.blank();
+                } else if (isPlayerHead(x, y, colorIndex)) {
+                    auto [_, __, dx, dy] = playerPositions.find(colorIndex)->second;
+                    out.put(playerColors[colorIndex], getDirectionSymbol(dx, dy));
                 } else {
-                    display += " ";
+                    out.put(playerColors[colorIndex], getTrailSymbol(colorIndex + 1, x, y));
                 }
             }
+            out.put(wallColor, style.wallVertical);
+            out.end();
             display += "\n";
         }
 
-        display += "\n" + std::string(GAME_FOOTER);
+        out.put(wallColor, style.wallBottomLeft);
+        for (int i = 0; i < camW; i++) {
+            display += style.wallHorizontal;
+        }
+        display += style.wallBottomRight;
+        out.end();
+        display += "\n\n" + std::string(GAME_FOOTER);
         
         return display;
     }
 
+    // Shown under the board only when the arena does not fit the camera.
+    std::string renderMinimap() {
+        if (!minimapW || !minimapH) return "";
+        int headX = -1, headY = -1;
+        auto me = playerPositions.find(myColorIndex);
+        if (me != playerPositions.end()) {
+            headX = std::get<0>(me->second) * minimapW / arenaW;
+            headY = std::get<1>(me->second) * minimapH / arenaH;
+        }
+        static const std::string head = "@", trail = "#";
+        std::string text;
+        SpanWriter out(text, style.color);
+        for (int y = 0; y < minimapH; y++) {
+            out.blank();
+            for (int x = 0; x < minimapW; x++) {
+                int value = minimap[y * minimapW + x];
+                if (x == headX && y == headY) {
+                    out.put(playerColors[myColorIndex], head);
+                } else if (value > 0 && value <= MAX_PLAYERS) {
+                    out.put(playerColors[value - 1], style.color ? trail : playerDigits[value - 1]);
+                } else {
+                    out.plain(".");
+                }
+            }
+            out.end();
+            text += "\n";
+        }
+        return text;
+    }
+
     void handleInput(char input) {
-        send(socket, &input, 1, 0);
+        sendFrame(socket, MSG_INPUT, &input, 1);
     }
 }; 
 
-void receiveGameState(int sock) {
-    char buffer[BUFFER_SIZE];
-    GameDisplay display(sock);  
-    std::string accumulatedData;
-    time_t lastHeartbeat = time(nullptr);
-    
-    int flags = fcntl(sock, F_GETFL, 0);
-    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
-    
+// Applies one message to the display. Returns true when the board changed and
+// a redraw is due; drawing is left to the event loop.
+bool applyMessage(GameDisplay& display, MessageType type, const char* data, size_t length,
+                  std::string& inflated) {
+    if (type == MSG_COMPRESSED) {
+        decodeCompressedFrame(data, length, type, inflated);
+        data = inflated.data();
+        length = inflated.size();
+    }
+    if (type == MSG_HELLO && length >= 1) {
+        DEBUG_LOG("Server accepted codecs:%d", static_cast<uint8_t>(data[0]));
+    } else if (type == MSG_INDEX) {
+        std::string indices(data, length);
+        size_t comma = indices.find(',');
+        if (comma != std::string::npos) {
+            int playerIndex = std::stoi(indices.substr(0, comma));
+            int colorIndex = std::stoi(indices.substr(comma + 1));
+            display.setMyIndices(playerIndex, colorIndex);
+            
+            DEBUG_LOG("Received indices - player:%d color:%d", playerIndex, colorIndex);
+        }
+    } else if (type == MSG_STATE) {
+        display.updateState(std::string(data, length));
+        return true;
+    }
+    return false;
+}
+
+void drawFrame(GameDisplay& display) {
+    clearScreen();
+    std::cout << wstrToStr(GAME_TITLE) << "\n\n";
+    std::cout << display.render() << "\n" << display.renderMinimap() << std::flush;
+}
+
+struct UdpSession {
+    int sock;
+    uint32_t id = 0;
+    UdpInputWindow inputs;
+};
+
+// Sends CONNECT until the server answers with ACCEPT or REJECT for our nonce.
+bool udpConnect(UdpSession& session, const std::string& name, std::string& index) {
+    std::random_device rd;
+    uint32_t nonce = rd();
+    std::string hello(1, static_cast<char>(UDP_CONNECT));
+    putU32(hello, nonce);
+    hello.push_back(static_cast<char>(localCodecs()));
+    hello += name;
+
+    char packet[BUFFER_SIZE];
+    for (int attempt = 0; attempt < UDP_CONNECT_ATTEMPTS; attempt++) {
+        send(session.sock, hello.data(), hello.size(), 0);
+        struct pollfd pfd = {session.sock, POLLIN, 0};
+        if (poll(&pfd, 1, UDP_CONNECT_RETRY_MS) <= 0) continue;
+
+        ssize_t n = recv(session.sock, packet, sizeof(packet), 0);
+        if (n < 5 || getU32(packet + 1) != nonce) continue;
+        if (packet[0] == UDP_REJECT) return false;
+        if (packet[0] == UDP_ACCEPT && n >= 10) {
+            session.id = getU32(packet + 5);
+            DEBUG_LOG("UDP session %u codecs:%d", session.id, static_cast<uint8_t>(packet[9]));
+            index.assign(packet + 10, n - 10);
+            return true;
+        }
+    }
+    return false;
+}
+
+void sendUdpInputs(UdpSession& session) {
+    std::string packet = session.inputs.encode(session.id);
+    send(session.sock, packet.data(), packet.size(), 0);
+}
+
+void sendUdpPing(UdpSession& session, PingWindow& ping) {
+    char packet[UDP_HEADER_SIZE + PING_PAYLOAD_SIZE];
+    writeUdpHeader(packet, UDP_PING, session.id);
+    ping.makePing(monotonicUs(), packet + UDP_HEADER_SIZE);
+    send(session.sock, packet, sizeof(packet), 0);
+}
+
+// Holds keys back so that at most one input message leaves per
+// INPUT_BATCH_MS. A key after a quiet period is released at once; keys
+// pressed within the same window ride along in the next message.
+class InputBatcher {
+private:
+    using Clock = std::chrono::steady_clock;
+    std::string pending;
+    Clock::time_point lastFlush;
+
+public:
+    void add(const std::string& keys) {
+        pending += keys;
+    }
+
+    // Milliseconds until the pending batch is due, or -1 when nothing waits.
+    int dueInMs(Clock::time_point now) const {
+        if (pending.empty()) return -1;
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            lastFlush + std::chrono::milliseconds(INPUT_BATCH_MS) - now).count();
+        return wait > 0 ? static_cast<int>(wait) : 0;
+    }
+
+    bool take(Clock::time_point now, std::string& batch) {
+        if (dueInMs(now) != 0) return false;
+        batch.swap(pending);
+        pending.clear();
+        lastFlush = now;
+        return true;
+    }
+};
+
+enum TransportMode {
+    TRANSPORT_TCP,          // TCP or Unix stream, framed
+    TRANSPORT_UDP,
+    TRANSPORT_SPECTATE,     // shared-memory ring, no connection
+};
+
+// The whole client runs on this one thread: keyboard, socket, heartbeats,
+// UDP resends and drawing all hang off a single poll(). Every state that
+// arrives is applied, but only the newest is drawn, at most CLIENT_MAX_FPS
+// times a second, so a client that fell behind catches up in one step.
+// Returns 0 when the player quits and 1 when the connection is lost.
+int runEventLoop(TransportMode mode, int sock, UdpSession* session, const std::string& index,
+                 const std::string& name, const RenderStyle& style) {
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+    const auto frameInterval = milliseconds(1000 / CLIENT_MAX_FPS);
+
+    GameDisplay display(sock, style);
+    KeyDecoder decoder;
+    decoder.loadKeymap(KEYMAP_FILE);
+    InputBatcher batcher;
+    FrameParser parser(MAX_DATA_BUFFER);
+    ShmFrameReader ring;
+    std::vector<char> packet(mode == TRANSPORT_UDP ? UDP_MAX_PACKET : 0);
+    std::string inflated, keys, batch, frame;
+    bool stdinOpen = true;
+    bool dirty = false;
+    uint64_t ringSeq = 0;
+    uint32_t stateSeq = 0;
+    bool haveState = false;
+    PingWindow ping;
+    char pingFrame[FRAME_HEADER_SIZE + PING_PAYLOAD_SIZE];
+    auto now = Clock::now();
+    auto lastRender = now - frameInterval;
+    auto lastSend = now;
+    auto lastPing = now;
+    auto lastState = now;
+
+    if (mode == TRANSPORT_SPECTATE && !ring.open(SHM_RING_NAME)) {
+        std::cerr << "无法打开共享内存 " << SHM_RING_NAME << std::endl;
+        return 1;
+    }
+    if (mode == TRANSPORT_TCP) {
+        std::string hello(1, static_cast<char>(localCodecs()));
+        hello += name;
+        sendFrame(sock, MSG_HELLO, hello.data(), hello.size());
+        int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    }
+    if (mode == TRANSPORT_UDP) {
+        applyMessage(display, MSG_INDEX, index.data(), index.size(), inflated);
+    }
+
     try {
         while (true) {
-            fd_set readfds;
-            FD_ZERO(&readfds);
-            FD_SET(sock, &readfds);
-            
-            struct timeval tv;
-            tv.tv_sec = 0;
-            tv.tv_usec = 100000;  
-            
-            int selectResult = select(sock + 1, &readfds, NULL, NULL, &tv);
-            
-            if (selectResult < 0) {
-                std::cerr << "Select error: " << strerror(errno) << std::endl;
-                break;
+            now = Clock::now();
+            int cols, rows;
+            if (terminalResized.exchange(false) && terminalViewport(cols, rows)) {
+                display.setViewport(cols, rows);
+                if (mode == TRANSPORT_TCP) {
+                    std::string viewport = encodeViewport(cols, rows);
+                    sendFrame(sock, MSG_VIEWPORT, viewport.data(), viewport.size());
+                }
+                dirty = true;
             }
-            
-            time_t now = time(nullptr);
-            
-            if (now - lastHeartbeat >= HEARTBEAT_INTERVAL) {
-                char heartbeat = 'h';
-                send(sock, &heartbeat, 1, 0);
-                lastHeartbeat = now;
+
+            // Sleep until the earliest of: next key batch, next heartbeat or
+            // resend, next allowed redraw, next ring poll.
+            auto untilMs = [&now](Clock::time_point t) {
+                auto ms = std::chrono::duration_cast<milliseconds>(t - now).count();
+                return ms > 0 ? static_cast<int>(ms) : 0;
+            };
+            int timeoutMs = HEARTBEAT_INTERVAL_MS;
+            int due = batcher.dueInMs(now);
+            if (due >= 0) timeoutMs = std::min(timeoutMs, due);
+            if (dirty) timeoutMs = std::min(timeoutMs, untilMs(lastRender + frameInterval));
+            if (mode == TRANSPORT_SPECTATE) timeoutMs = std::min(timeoutMs, SHM_POLL_MS);
+            if (mode != TRANSPORT_SPECTATE) {
+                timeoutMs = std::min(timeoutMs, untilMs(lastPing + milliseconds(HEARTBEAT_INTERVAL_MS)));
             }
-            
-            if (selectResult > 0 && FD_ISSET(sock, &readfds)) {
-                memset(buffer, 0, BUFFER_SIZE);
-                int bytesRead = recv(sock, buffer, BUFFER_SIZE - 1, 0);
-                
-                if (bytesRead <= 0) {
-                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            if (mode == TRANSPORT_UDP && session->inputs.pending()) {
+                timeoutMs = std::min(timeoutMs, untilMs(lastSend + milliseconds(UDP_INPUT_RESEND_MS)));
+            }
+
+            struct pollfd fds[2];
+            int nfds = 0, stdinSlot = -1, sockSlot = -1;
+            if (stdinOpen) {
+                fds[nfds] = {STDIN_FILENO, POLLIN, 0};
+                stdinSlot = nfds++;
+            }
+            if (mode != TRANSPORT_SPECTATE) {
+                fds[nfds] = {sock, POLLIN, 0};
+                sockSlot = nfds++;
+            }
+            if (poll(fds, nfds, timeoutMs) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("poll: ") + strerror(errno));
+            }
+            now = Clock::now();
+
+            if (stdinSlot >= 0 && fds[stdinSlot].revents) {
+                keys.clear();
+                if ((fds[stdinSlot].revents & (POLLHUP | POLLERR)) || readKeys(decoder, keys) == 0) {
+                    stdinOpen = false;
+                }
+                if (keys.find_first_of("qQ") != std::string::npos) return 0;
+                if (mode != TRANSPORT_SPECTATE) batcher.add(keys);
+            }
+
+            if (sockSlot >= 0 && (fds[sockSlot].revents & (POLLIN | POLLHUP | POLLERR))) {
+                if (mode == TRANSPORT_TCP) {
+                    ssize_t bytesRead = parser.readFrom(sock);
+                    if (bytesRead == 0 || (bytesRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
                         throw std::runtime_error("Connection lost");
                     }
-                    continue;
-                }
-                
-                #ifdef DEBUG_MODE
-                std::cout << "Received " << bytesRead << " bytes" << std::endl;
-                #endif
-                
-                std::string data(buffer, bytesRead);
-                
-                if (data.find("INDEX:") == 0) {
-                    size_t comma = data.find(",", 6);
-                    if (comma != std::string::npos) {
-                        int playerIndex = std::stoi(data.substr(6, comma - 6));
-                        int colorIndex = std::stoi(data.substr(comma + 1));
-                        display.setMyIndices(playerIndex, colorIndex);
-                        
-                        DEBUG_LOG("Received indices - player:%d color:%d", playerIndex, colorIndex);
+                    MessageType type;
+                    const char* data;
+                    size_t length;
+                    while (parser.next(type, data, length)) {
+                        if (type == MSG_HEARTBEAT && length == PING_PAYLOAD_SIZE) {
+                            sendFrame(sock, MSG_HEARTBEAT_ACK, data, length);
+                        } else if (type == MSG_HEARTBEAT_ACK) {
+                            if (ping.onAck(data, length, monotonicUs())) {
+                                display.setLinkStats(ping.stats(monotonicUs()));
+                                dirty = true;
+                            }
+                        } else {
+                            dirty |= applyMessage(display, type, data, length, inflated);
+                        }
+                    }
+                } else {
+                    // Drain the socket and keep only the newest snapshot;
+                    // older or duplicated ones are dropped by sequence number.
+                    frame.clear();
+                    ssize_t n;
+                    while ((n = recv(sock, packet.data(), packet.size(), MSG_DONTWAIT)) > 0) {
+                        if (n < static_cast<ssize_t>(UDP_HEADER_SIZE) || getU32(&packet[1]) != session->id) {
+                            continue;
+                        }
+                        if (packet[0] == UDP_PING && n == static_cast<ssize_t>(UDP_HEADER_SIZE + PING_PAYLOAD_SIZE)) {
+                            packet[0] = static_cast<char>(UDP_PONG);
+                            send(sock, packet.data(), n, 0);
+                            continue;
+                        }
+                        if (packet[0] == UDP_PONG) {
+                            if (ping.onAck(&packet[UDP_HEADER_SIZE], n - UDP_HEADER_SIZE, monotonicUs())) {
+                                display.setLinkStats(ping.stats(monotonicUs()));
+                                dirty = true;
+                            }
+                            continue;
+                        }
+                        if (packet[0] != UDP_STATE || n < static_cast<ssize_t>(UDP_STATE_HEADER_SIZE)) {
+                            continue;
+                        }
+                        lastState = now;
+                        uint32_t seq = getU32(&packet[5]);
+                        session->inputs.ack(getU32(&packet[9]));
+                        if (haveState && !seqNewer(seq, stateSeq)) {
+                            DEBUG_LOG("Dropped stale snapshot %u (have %u)", seq, stateSeq);
+                            continue;
+                        }
+                        haveState = true;
+                        stateSeq = seq;
+                        frame.assign(&packet[UDP_STATE_HEADER_SIZE], n - UDP_STATE_HEADER_SIZE);
+                    }
+                    MessageType type;
+                    const char* data;
+                    size_t length;
+                    if (!frame.empty() && parseFrame(frame.data(), frame.size(), type, data, length)) {
+                        dirty |= applyMessage(display, type, data, length, inflated);
                     }
-                    continue;
                 }
-                
-                accumulatedData.append(data);
-                
-                size_t beginPos = 0;
-                while ((beginPos = accumulatedData.find("BEGIN\n")) != std::string::npos) {
-                    size_t endPos = accumulatedData.find("END\n", beginPos);
-                    if (endPos == std::string::npos) break;
-                    
-                    endPos += 4; 
-                    std::string statePacket = accumulatedData.substr(beginPos, endPos - beginPos);
-                    
-                    try {
-                        display.updateState(statePacket);
-                        clearScreen();
-                        std::cout << wstrToStr(GAME_TITLE) << "\n\n";
-                        std::cout << addBorder(display.render()) << std::flush;
-                    } catch (const std::exception& e) {
-                        std::cerr << "Error updating state: " << e.what() << std::endl;
+            }
+
+            if (mode == TRANSPORT_SPECTATE) {
+                bool fresh = ring.readLatest(ringSeq, [&frame](const char* data, size_t length) {
+                    frame.assign(data, length);
+                });
+                MessageType type;
+                const char* data;
+                size_t length;
+                if (fresh && parseFrame(frame.data(), frame.size(), type, data, length)) {
+                    dirty |= applyMessage(display, type, data, length, inflated);
+                }
+            }
+
+            if (batcher.take(now, batch)) {
+                // Stamped with the tick on screen so the server can judge the
+                // turn against the board the player was reacting to.
+                if (mode == TRANSPORT_UDP) {
+                    for (char key : batch) session->inputs.push(key, display.seenTick());
+                    sendUdpInputs(*session);
+                } else {
+                    std::string payload;
+                    putU32(payload, display.seenTick());
+                    payload += batch;
+                    if (!sendFrame(sock, MSG_INPUT_AT, payload.data(), payload.size())) {
+                        throw std::runtime_error("Connection lost");
                     }
-                    
-                    accumulatedData.erase(0, endPos);
                 }
-                
-                if (accumulatedData.length() > MAX_DATA_BUFFER) {
-                    accumulatedData.clear();
+                lastSend = now;
+            }
+
+            // Pings go out on their own clock, typing or not, so the RTT
+            // window keeps filling.
+            if (mode != TRANSPORT_SPECTATE && now - lastPing >= milliseconds(HEARTBEAT_INTERVAL_MS)) {
+                if (mode == TRANSPORT_TCP) {
+                    writeFrameHeader(pingFrame, MSG_HEARTBEAT, PING_PAYLOAD_SIZE);
+                    ping.makePing(monotonicUs(), pingFrame + FRAME_HEADER_SIZE);
+                    sendAll(sock, pingFrame, sizeof(pingFrame));
+                    lastSend = now;
+                } else {
+                    sendUdpPing(*session, ping);     // resends go by lastSend, not this clock
                 }
+                display.setLinkStats(ping.stats(monotonicUs()));    // ages unanswered pings into loss
+                lastPing = now;
+            }
+            if (mode == TRANSPORT_UDP) {
+                // Unacked keys are resent every UDP_INPUT_RESEND_MS; an empty
+                // INPUT is the keepalive.
+                auto sinceSend = now - lastSend;
+                if ((session->inputs.pending() && sinceSend >= milliseconds(UDP_INPUT_RESEND_MS)) ||
+                    sinceSend >= milliseconds(HEARTBEAT_INTERVAL_MS)) {
+                    sendUdpInputs(*session);
+                    lastSend = now;
+                }
+                if (now - lastState >= milliseconds(CONNECTION_TIMEOUT_MS)) {
+                    throw std::runtime_error("Connection lost");
+                }
+            }
+
+            if (dirty && now - lastRender >= frameInterval) {
+                drawFrame(display);
+                lastRender = now;
+                dirty = false;
             }
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error in receiveGameState: " << e.what() << std::endl;
+        std::cerr << "Error in event loop: " << e.what() << std::endl;
     }
+    return 1;
 }
 
-int main() {
+struct ClientOptions {
+    bool useUdp = false;
+    bool useUnix = false;
+    bool spectate = false;
+    bool ascii = false;
+    bool mono = false;
+    long room = -1;             // multi-worker servers only; TCP and Unix socket
+    std::string name;           // stats are kept under it; empty plays anonymously
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--udp | --unix | --spectate] [--room N]"
+              << " [--name NAME] [--ascii] [--mono]" << std::endl
+              << "  NAME: up to " << PLAYER_NAME_MAX_LENGTH
+              << " bytes; without it no scores or stats are kept" << std::endl;
+}
+
+// Flags may come in any order; conflicting transports are refused rather
+// than one silently winning.
+static bool parseOptions(int argc, char* argv[], ClientOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--udp") == 0) {
+            opt.useUdp = true;
+        } else if (strcmp(argv[i], "--unix") == 0) {
+            opt.useUnix = true;
+        } else if (strcmp(argv[i], "--spectate") == 0) {
+            opt.spectate = true;
+        } else if (strcmp(argv[i], "--ascii") == 0) {
+            opt.ascii = true;
+        } else if (strcmp(argv[i], "--mono") == 0) {
+            opt.mono = true;
+        } else if (strcmp(argv[i], "--room") == 0 && i + 1 < argc) {
+            char* end;
+            opt.room = strtol(argv[++i], &end, 10);
+            if (*end || opt.room < 0) return false;
+        } else if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            opt.name = argv[++i];
+            if (opt.name.empty() || opt.name.size() > PLAYER_NAME_MAX_LENGTH) return false;
+        } else {
+            return false;
+        }
+    }
+    int transports = opt.useUdp + opt.useUnix + opt.spectate;
+    return transports <= 1 && (opt.room < 0 || !(opt.useUdp || opt.spectate)) &&
+           (opt.name.empty() || !opt.spectate);
+}
+
+int main(int argc, char* argv[]) {
+    ClientOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    bool useUdp = options.useUdp;
+    bool useUnix = options.useUnix;
+    long room = options.room;
     setlocale(LC_ALL, "");
+    RenderStyle style = detectRenderStyle(options.ascii, options.mono);
     std::cout << "\033[?25l";  
+    signal(SIGWINCH, onWindowChange);
+    terminal::enableRaw();
+
+    if (options.spectate) {
+        int result = runEventLoop(TRANSPORT_SPECTATE, -1, nullptr, "", "", style);
+        terminal::restore();
+        std::cout << "\033[?25h";  
+        return result;
+    }
 
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int sock = socket(useUnix ? AF_UNIX : AF_INET, useUdp ? SOCK_DGRAM : SOCK_STREAM, 0);
     struct sockaddr_in serverAddr;
     serverAddr.sin_family = AF_INET;
     serverAddr.sin_port = htons(SERVER_PORT);
     serverAddr.sin_addr.s_addr = inet_addr(SERVER_IP);
+    struct sockaddr_un unixAddr = {};
+    unixAddr.sun_family = AF_UNIX;
+    strncpy(unixAddr.sun_path, UNIX_SOCKET_PATH, sizeof(unixAddr.sun_path) - 1);
+    const struct sockaddr* addr = useUnix ? (struct sockaddr*)&unixAddr 
+                                          : (struct sockaddr*)&serverAddr;
+    socklen_t addrLen = useUnix ? sizeof(unixAddr) : sizeof(serverAddr);
 
     int maxRetries = 3;
     int retryCount = 0;
     while (retryCount < maxRetries) {
-        if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == 0) {
+        if (connect(sock, addr, addrLen) == 0) {
             break;
         }
         std::cerr << "连接失败，重试中... (" << retryCount + 1 << "/" << maxRetries << ")" << std::endl;
@@ -483,30 +992,36 @@ int main() {
         return 1;
     }
 
+    UdpSession session;
+    session.sock = sock;
+    std::string index;
+    if (useUdp && !udpConnect(session, options.name, index)) {
+        std::cerr << "无法连接到服务器" << std::endl;
+        close(sock);
+        return 1;
+    }
+
+    // Must precede HELLO: a multi-worker server routes on the first frame.
+    if (!useUdp && room >= 0) {
+        std::string join;
+        putU32(join, static_cast<uint32_t>(room));
+        sendFrame(sock, MSG_JOIN, join.data(), join.size());
+    }
+
     std::cout << "已连接到服务器" << std::endl;
 
-    std::atomic<bool> running{true};
-    std::thread receiveThread([sock, &running]() {
-        receiveGameState(sock);
-        running = false;
-    });
+    int result = runEventLoop(useUdp ? TRANSPORT_UDP : TRANSPORT_TCP, sock, &session, index,
+                              options.name, style);
 
-    while (running) {
-        char input = getch();
-        if (input == 'q' || input == 'Q') {
-            running = false;
-            break;
-        }
-        if (send(sock, &input, 1, 0) <= 0) {
-            running = false;
-            break;
-        }
+    if (useUdp) {
+        std::string bye(1, static_cast<char>(UDP_DISCONNECT));
+        putU32(bye, session.id);
+        send(sock, bye.data(), bye.size(), 0);
     }
-
     shutdown(sock, SHUT_RDWR); 
     close(sock);
-    receiveThread.join();      
     
+    terminal::restore();
     std::cout << "\033[?25h";  
-    return 0;
-}
\ No newline at end of file
+    return result;
+}
@@ -0,0 +1,202 @@
+#ifndef TRON_COMPRESS_H
+#define TRON_COMPRESS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "config.h"
+
+#ifdef TRON_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Codec bits exchanged in MSG_HELLO. Each side advertises what it can decode;
+// the server intersects that with its own set and answers with the result.
+enum CodecFlags : uint8_t {
+    CODEC_RLE = 1,          // board rows sent as value*count runs
+    CODEC_LZ = 2,           // built-in LZ77, always available
+    CODEC_DEFLATE = 4,      // zlib, only when built with ZLIB=1
+};
+
+inline uint8_t localCodecs() {
+#ifdef TRON_HAVE_ZLIB
+    return CODEC_RLE | CODEC_LZ | CODEC_DEFLATE;
+#else
+    return CODEC_RLE | CODEC_LZ;
+#endif
+}
+
+// Appends one board row as comma-terminated cells, collapsing repeats into
+// "value*count". A row of empty cells becomes "0*78,".
+inline void appendRleRow(std::string& out, const int* row, int width) {
+    char buf[24];
+    int x = 0;
+    while (x < width) {
+        int value = row[x];
+        int run = 1;
+        while (x + run < width && row[x + run] == value) run++;
+        int n = run > 1 ? snprintf(buf, sizeof(buf), "%d*%d,", value, run)
+                        : snprintf(buf, sizeof(buf), "%d,", value);
+        out.append(buf, n);
+        x += run;
+    }
+}
+
+// Built-in LZ77 with an LZ4-style sequence layout:
+//   [token: literal len (hi nibble) | match len - 4 (lo nibble)]
+//   [extra literal len bytes][literals][u16 offset LE][extra match len bytes]
+// A nibble of 15 is followed by bytes of 255 until one is smaller. The last
+// sequence carries literals only.
+namespace lz {
+
+constexpr int MIN_MATCH = 4;
+constexpr int HASH_BITS = 12;
+constexpr size_t MAX_OFFSET = 65535;
+
+inline uint32_t read32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline void putLength(std::string& out, size_t extra) {
+    while (extra >= 255) {
+        out.push_back(static_cast<char>(255));
+        extra -= 255;
+    }
+    out.push_back(static_cast<char>(extra));
+}
+
+inline void putSequence(std::string& out, const char* literals, size_t litLen,
+                        size_t offset, size_t matchLen) {
+    size_t m = matchLen ? matchLen - MIN_MATCH : 0;
+    uint8_t token = static_cast<uint8_t>((litLen < 15 ? litLen : 15) << 4 | (m < 15 ? m : 15));
+    out.push_back(static_cast<char>(token));
+    if (litLen >= 15) putLength(out, litLen - 15);
+    out.append(literals, litLen);
+    if (!matchLen) return;
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (m >= 15) putLength(out, m - 15);
+}
+
+inline void compress(const char* src, size_t length, std::string& out) {
+    uint32_t table[1 << HASH_BITS] = {};    // position + 1, 0 = empty
+    size_t anchor = 0, pos = 0;
+    while (length >= MIN_MATCH && pos + MIN_MATCH <= length) {
+        uint32_t v = read32(src + pos);
+        uint32_t h = hash(v);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+            read32(src + candidate - 1) != v) {
+            pos++;
+            continue;
+        }
+        size_t ref = candidate - 1;
+        size_t matchLen = MIN_MATCH;
+        while (pos + matchLen < length && src[ref + matchLen] == src[pos + matchLen]) matchLen++;
+        putSequence(out, src + anchor, pos - anchor, pos - ref, matchLen);
+        pos += matchLen;
+        anchor = pos;
+    }
+    putSequence(out, src + anchor, length - anchor, 0, 0);
+}
+
+inline size_t getLength(const uint8_t*& p, const uint8_t* end, size_t nibble) {
+    if (nibble < 15) return nibble;
+    size_t length = nibble;
+    uint8_t b;
+    do {
+        if (p >= end) throw std::runtime_error("truncated lz length");
+        b = *p++;
+        length += b;
+    } while (b == 255);
+    return length;
+}
+
+inline void decompress(const char* src, size_t length, std::string& out, size_t rawLength) {
+    out.resize(rawLength);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = p + length;
+    size_t o = 0;
+    while (p < end) {
+        uint8_t token = *p++;
+        size_t litLen = getLength(p, end, token >> 4);
+        if (litLen > static_cast<size_t>(end - p) || litLen > rawLength - o) {
+            throw std::runtime_error("lz literal overrun");
+        }
+        memcpy(&out[o], p, litLen);
+        p += litLen;
+        o += litLen;
+        if (p == end) break;
+        if (end - p < 2) throw std::runtime_error("truncated lz offset");
+        size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        size_t matchLen = getLength(p, end, token & 15) + MIN_MATCH;
+        if (offset == 0 || offset > o || matchLen > rawLength - o) {
+            throw std::runtime_error("lz match out of range");
+        }
+        // Byte-wise so overlapping matches repeat, e.g. offset 1 is a run.
+        for (size_t i = 0; i < matchLen; i++, o++) out[o] = out[o - offset];
+    }
+    if (o != rawLength) throw std::runtime_error("lz length mismatch");
+}
+
+}  // namespace lz
+
+// Compresses with the best codec in `codecs`. Returns the codec used, or 0
+// when none applies or the result would not be smaller than the input.
+inline uint8_t compressPayload(uint8_t codecs, const std::string& raw, std::string& out) {
+    out.clear();
+    if (raw.size() < COMPRESS_MIN_BYTES) return 0;
+#ifdef TRON_HAVE_ZLIB
+    if (codecs & CODEC_DEFLATE) {
+        uLongf size = compressBound(raw.size());
+        out.resize(size);
+        if (compress2(reinterpret_cast<Bytef*>(&out[0]), &size,
+                      reinterpret_cast<const Bytef*>(raw.data()), raw.size(),
+                      COMPRESS_DEFLATE_LEVEL) == Z_OK && size < raw.size()) {
+            out.resize(size);
+            return CODEC_DEFLATE;
+        }
+        out.clear();
+    }
+#endif
+    if (codecs & CODEC_LZ) {
+        lz::compress(raw.data(), raw.size(), out);
+        if (out.size() < raw.size()) return CODEC_LZ;
+        out.clear();
+    }
+    return 0;
+}
+
+inline void decompressPayload(uint8_t codec, const char* data, size_t length,
+                              std::string& out, size_t rawLength) {
+    if (rawLength > MAX_FRAME_SIZE) throw std::runtime_error("compressed frame too large");
+    if (codec == CODEC_LZ) {
+        lz::decompress(data, length, out, rawLength);
+        return;
+    }
+#ifdef TRON_HAVE_ZLIB
+    if (codec == CODEC_DEFLATE) {
+        out.resize(rawLength);
+        uLongf size = rawLength;
+        if (uncompress(reinterpret_cast<Bytef*>(&out[0]), &size,
+                       reinterpret_cast<const Bytef*>(data), length) != Z_OK ||
+            size != rawLength) {
+            throw std::runtime_error("deflate stream corrupt");
+        }
+        return;
+    }
+#endif
+    throw std::runtime_error("unsupported codec");
+}
+
+#endif
@@ -23,9 +23,14 @@
 #define SOCKET_TIMEOUT 10
 #define SELECT_TIMEOUT_MS 100
 
-#define MAX_PENDING_CONNECTIONS 5
+#define LISTEN_BACKLOG 4096
+#define JOIN_ADMITS_PER_TICK 32
 #define HEARTBEAT_INTERVAL 1
 #define MAX_DATA_BUFFER 16384
+#define FRAME_HEADER_SIZE 5
+#define MAX_FRAME_SIZE (8 * 1024 * 1024)
+#define COMPRESS_MIN_BYTES 64
+#define COMPRESS_DEFLATE_LEVEL 6
 
 #define GAME_SPEED_MS 300
 #define RESET_DELAY_MS 3000
@@ -35,6 +40,9 @@
 #define KEY_DOWN 's'
 #define KEY_LEFT 'a'
 #define KEY_RIGHT 'd'
+#define KEYMAP_FILE "keymap.txt"
+#define INPUT_BATCH_MS (GAME_SPEED_MS / 3)
+#define CLIENT_MAX_FPS 30
 
 #define PLAYER_UP L"⇡"
 #define PLAYER_LEFT L"⇠"
@@ -55,6 +63,15 @@
 #define WALL_BOTTOM_RIGHT L"╝"
 #define WALL_BOTTOM_LEFT L"╚"
 
+#define ASCII_PLAYER_UP "^"
+#define ASCII_PLAYER_LEFT "<"
+#define ASCII_PLAYER_DOWN "v"
+#define ASCII_PLAYER_RIGHT ">"
+#define ASCII_TRAIL_HORIZONTAL "-"
+#define ASCII_TRAIL_VERTICAL "|"
+#define ASCII_TRAIL_CORNER "+"
+#define ASCII_WALL "#"
+
 #define GAME_WIDTH (BOARD_WIDTH - 2)
 #define GAME_HEIGHT (BOARD_HEIGHT - 2)
 
@@ -72,7 +89,11 @@
 #define SCORE_SURVIVAL_TIME 2
 #define SCORE_KILL_POINTS 50
 #define SCORE_TRANSFER_RATE 1.0
-#define HIGH_SCORE_FILE "highscores.txt"
+#define STATS_FILE "playerstats.db"
+#define STATS_INITIAL_CAPACITY 1024
+#define STATS_SYNC_MS 5000
+#define STATS_SEED_PER_TICK 4096
+#define STATS_MIGRATE_PER_TICK 4096
 
 #define GAME_WAITING 0
 #define GAME_RUNNING 1
@@ -86,7 +107,7 @@
 #define ERROR_TIMEOUT -3
 
 #define GAME_TITLE L"Welcome to TronGame"
-#define GAME_HEADER_FORMAT "Score:%d | Your High Score:%d | Game High Score:%d "
+#define GAME_HEADER_FORMAT "Score:%d | Your High Score:%d | Game High Score:%d | Rank:%s | Ping:%s "
 #define GAME_FOOTER "Warning: Other Players Must be in This Game for You to Score!"
 #define PLAYER_NAME_MAX_LENGTH 20
 
@@ -104,11 +125,63 @@
 
 #define HEARTBEAT_INTERVAL_MS 300
 #define CONNECTION_TIMEOUT_MS 5000
+#define OUTBOX_MAX_BYTES (256 * 1024)
+#define HEARTBEAT_DEADLINE_MS (HEARTBEAT_INTERVAL_MS * 3)
+#define PING_WINDOW 32
+#define PING_LOSS_MS 2000
+#define TIMER_WHEEL_TICK_MS 10
+#define LAG_COMP_TICKS 3
+
+#define UDP_ENABLED 1
+#define UDP_SESSION_BASE (1 << 24)
+#define UDP_CONNECT_RETRY_MS 250
+#define UDP_CONNECT_ATTEMPTS 8
+#define UDP_INPUT_RESEND_MS 50
+#define UDP_INPUT_WINDOW 32
+#define UDP_MAX_PACKET 65507
+
+#define UNIX_SOCKET_ENABLED 1
+#define UNIX_SOCKET_PATH "/tmp/tron.sock"
+#define SHM_RING_ENABLED 1
+#define SHM_RING_NAME "/tron_frames"
+#define SHM_RING_SLOTS 64
+#define SHM_RING_SLOT_SIZE MAX_DATA_BUFFER
+#define SHM_POLL_MS 10
+
+#define HANDOFF_SOCKET_PATH "/tmp/tron_handoff.sock"
+#define HANDOFF_TIMEOUT_MS 5000
+#define HANDOFF_FDS_PER_MSG 200
+
+#define ADMIN_SOCKET_PATH "/tmp/tron_admin.sock"
+#define ADMIN_MAX_LINE 1024
+
+#define WORKER_JOIN_WAIT_MS 500
+
+#define TRACE_BUFFER_EVENTS 16384
+#define TRACE_FILE "tron_trace.json"
+
+#define VIEWPORT_MARGIN 4
+#define VIEWPORT_MIN_COLS 20
+#define VIEWPORT_MIN_ROWS 6
+#define MINIMAP_WIDTH 26
+#define MINIMAP_HEIGHT 5
 
 #define GAME_STATE_SYNC_MS 100
 
 #define RESPAWN_DELAY 1
+#define TRAIL_DECAY_TICKS 40
 #define RESPAWN_PROTECTION 1
 #define RESPAWN_SAFE_RADIUS 5
 
+#define USE_BITBOARD 1
+
+#define BOTS_ENABLED 1
+#define BOT_LEVEL_EASY 1
+#define BOT_LEVEL_MEDIUM 2
+#define BOT_LEVEL_HARD 3
+#define BOT_DEFAULT_LEVEL BOT_LEVEL_MEDIUM
+#define BOT_MAX_DEPTH 3
+#define BOT_AREA_LIMIT (BOARD_WIDTH * BOARD_HEIGHT)
+#define BOT_TICK_BUDGET_US 2000
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "config.h"
+#include "tron_sim.h"
+
+// Desync / regression checker. --record plays a seeded game (bots, or random
+// turns at level 0) and writes every input and the state hash after every
+// tick; --replay feeds the same inputs through this build's simulation and
+// stops at the first tick whose hash differs. Record with one build, replay
+// with another, and a change to the rules or the board layout shows up as
+// the exact tick it first mattered. Inputs are recorded, so bot changes do
+// not count as divergence.
+//
+// Recording (text, one item per line):
+//   tronrec 1 <mode> <seed> <width> <height>
+//   player <id> <level>            in join order
+//   start <state hash> <board hash>
+//   in <id> <key>                  inputs of the next tick
+//   tick <n> <state hash> <board hash>
+
+struct DesyncOptions {
+    std::string record, replay;
+    std::string mode = "classic";
+    int ticks = 1000;
+    int players = MAX_PLAYERS;
+    int level = 0;
+    uint64_t seed = 1;
+    bool verify = false;        // also recompute the board hash from scratch each tick
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --record FILE [--mode M] [--ticks N] [--players N]"
+              << " [--level 0-" << BOT_LEVEL_HARD << "] [--seed N]" << std::endl
+              << "       " << prog << " --replay FILE [--verify]" << std::endl
+              << "  modes: classic wrap decay rounds" << std::endl;
+}
+
+static bool parseOptions(int argc, char** argv, DesyncOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--verify")) {
+            opt.verify = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (!strcmp(argv[i - 1], "--record")) opt.record = value;
+        else if (!strcmp(argv[i - 1], "--replay")) opt.replay = value;
+        else if (!strcmp(argv[i - 1], "--mode")) opt.mode = value;
+        else if (!strcmp(argv[i - 1], "--ticks")) opt.ticks = atoi(value);
+        else if (!strcmp(argv[i - 1], "--players")) opt.players = atoi(value);
+        else if (!strcmp(argv[i - 1], "--level")) opt.level = atoi(value);
+        else if (!strcmp(argv[i - 1], "--seed")) opt.seed = strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return opt.record.empty() != opt.replay.empty() && opt.ticks > 0 &&
+           opt.players > 0 && opt.players <= MAX_PLAYERS &&
+           opt.level >= 0 && opt.level <= BOT_LEVEL_HARD;
+}
+
+static void writeHashes(std::ofstream& out, const SimState& sim) {
+    char text[48];
+    snprintf(text, sizeof(text), "%016llx %016llx", (unsigned long long)simHash(sim),
+             (unsigned long long)sim.boardHash);
+    out << text << "\n";
+}
+
+template <class Rules>
+static int record(const DesyncOptions& opt) {
+    std::ofstream out(opt.record);
+    if (!out) {
+        std::cerr << "Cannot write " << opt.record << std::endl;
+        return 1;
+    }
+    SimState sim;
+    simInit(sim, opt.seed);
+    std::vector<SimEvent> events;
+    out << "tronrec 1 " << opt.mode << " " << opt.seed << " " << sim.width << " "
+        << sim.height << "\n";
+    for (int id = 0; id < opt.players; id++) {
+        simAddPlayer(sim, id, 0, opt.level, events);
+        out << "player " << id << " " << opt.level << "\n";
+    }
+    out << "start ";
+    writeHashes(out, sim);
+
+    // Random turns draw from their own generator: the game's must only move
+    // inside simStep, or a replay would see a different sequence.
+    SimState turns;
+    turns.rng = opt.seed ^ 0x5DEECE66DULL;
+    static const char keys[4] = {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT};
+    SimBotDriver<Rules> bots;
+    std::vector<SimInput> inputs;
+    for (int t = 0; t < opt.ticks; t++) {
+        inputs.clear();
+        events.clear();
+        if (opt.level > 0) {
+            bots.decide(sim, inputs);
+        } else {
+            for (const auto& p : sim.players) {
+                uint64_t r = simRandom(turns);
+                if ((r & 7) == 0) inputs.push_back({p.id, keys[(r >> 3) & 3]});
+            }
+        }
+        for (const auto& input : inputs) {
+            out << "in " << input.playerId << " " << static_cast<int>(input.key) << "\n";
+        }
+        simStep<Rules>(sim, inputs.data(), inputs.size(), events);
+        out << "tick " << sim.tick << " ";
+        writeHashes(out, sim);
+    }
+    std::cout << "recorded " << opt.ticks << " ticks of " << opt.mode << " to " << opt.record
+              << std::endl;
+    return out.good() ? 0 : 1;
+}
+
+// Compares this build's state with a recorded "<state> <board>" pair.
+static bool sameHashes(const SimState& sim, std::istringstream& line, const char* where) {
+    std::string state, board;
+    line >> state >> board;
+    uint64_t wantState = strtoull(state.c_str(), nullptr, 16);
+    uint64_t wantBoard = strtoull(board.c_str(), nullptr, 16);
+    uint64_t gotState = simHash(sim);
+    if (gotState == wantState) return true;
+    printf("DIVERGED at %s: state %016llx, recorded %016llx (%s)\n", where,
+           (unsigned long long)gotState, (unsigned long long)wantState,
+           sim.boardHash != wantBoard ? "board differs" : "board matches; players, clock or scoring differ");
+    return false;
+}
+
+template <class Rules>
+static int replay(std::ifstream& in, const std::string& mode, uint64_t seed, int width,
+                  int height, bool verify) {
+    SimState sim;
+    simInit(sim, seed, width, height);
+    std::vector<SimEvent> events;
+    std::vector<SimInput> inputs;
+    std::string text, word;
+    uint64_t ticks = 0;
+    while (std::getline(in, text)) {
+        std::istringstream line(text);
+        line >> word;
+        if (word == "player") {
+            int id, level;
+            line >> id >> level;
+            if (!simAddPlayer(sim, id, 0, level, events)) {
+                printf("DIVERGED at setup: player %d has no slot\n", id);
+                return 1;
+            }
+        } else if (word == "start") {
+            if (!sameHashes(sim, line, "setup")) return 1;
+        } else if (word == "in") {
+            int id, key;
+            line >> id >> key;
+            inputs.push_back({id, static_cast<char>(key)});
+        } else if (word == "tick") {
+            uint64_t tick;
+            line >> tick;
+            events.clear();
+            simStep<Rules>(sim, inputs.data(), inputs.size(), events);
+            inputs.clear();
+            std::string where = "tick " + std::to_string(tick);
+            if (sim.tick != tick || !sameHashes(sim, line, where.c_str())) return 1;
+            if (verify && sim.boardHash != boardHash(sim.cells.data(), sim.cells.size())) {
+                printf("BOARD HASH DRIFT at tick %llu: a cell changed without simSetCell\n",
+                       (unsigned long long)tick);
+                return 1;
+            }
+            ticks++;
+        }
+    }
+    printf("%llu ticks of %s match\n", (unsigned long long)ticks, mode.c_str());
+    return 0;
+}
+
+struct DesyncMode {
+    const char* name;
+    int (*record)(const DesyncOptions&);
+    int (*replay)(std::ifstream&, const std::string&, uint64_t, int, int, bool);
+};
+
+static const DesyncMode modes[] = {
+    {"classic", record<ClassicRules>, replay<ClassicRules>},
+    {"wrap", record<WrapRules>, replay<WrapRules>},
+    {"decay", record<DecayRules>, replay<DecayRules>},
+    {"rounds", record<RoundsRules>, replay<RoundsRules>},
+};
+
+static const DesyncMode* findMode(const std::string& name) {
+    for (const auto& mode : modes) {
+        if (name == mode.name) return &mode;
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    DesyncOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!opt.record.empty()) {
+        const DesyncMode* mode = findMode(opt.mode);
+        if (!mode) {
+            usage(argv[0]);
+            return 1;
+        }
+        return mode->record(opt);
+    }
+
+    std::ifstream in(opt.replay);
+    std::string magic, name;
+    int version = 0, width = 0, height = 0;
+    uint64_t seed = 0;
+    if (!(in >> magic >> version >> name >> seed >> width >> height) || magic != "tronrec" ||
+        version != 1 || width <= 0 || height <= 0) {
+        std::cerr << "Not a recording: " << opt.replay << std::endl;
+        return 1;
+    }
+    const DesyncMode* mode = findMode(name);
+    if (!mode) {
+        std::cerr << "Unknown mode in recording: " << name << std::endl;
+        return 1;
+    }
+    return mode->replay(in, name, seed, width, height, opt.verify);
+}
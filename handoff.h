@@ -0,0 +1,253 @@
+#ifndef TRON_HANDOFF_H
+#define TRON_HANDOFF_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "config.h"
+#include "tron_sim.h"
+#include "udp_transport.h"
+
+// Hot restart. A new server started with --takeover connects to the running
+// one on HANDOFF_SOCKET_PATH. The old process parks its connection threads,
+// passes every listening and client socket over SCM_RIGHTS, sends a snapshot
+// of the room and exits once the new process reports that it is ticking.
+// Clients keep their TCP connections and UDP sessions throughout.
+//
+// On the handoff socket:
+//   old -> new  [u32 fd count], then the fds in batches of HANDOFF_FDS_PER_MSG
+//   old -> new  [u32 length][listener mask u8][snapshot]
+//   new -> old  'R' after its first tick
+namespace handoff {
+
+constexpr uint32_t MAGIC = 0x54524835;     // "TRH5"
+constexpr int MAX_BOARD_SIDE = 4096;
+
+inline bool writeAll(int sock, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(sock, data, length, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+inline bool readAll(int sock, char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = recv(sock, data, length, 0);
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+inline bool sendFds(int sock, const std::vector<int>& fds) {
+    std::string count;
+    putU32(count, static_cast<uint32_t>(fds.size()));
+    if (!writeAll(sock, count.data(), count.size())) return false;
+    for (size_t i = 0; i < fds.size(); i += HANDOFF_FDS_PER_MSG) {
+        size_t n = std::min<size_t>(HANDOFF_FDS_PER_MSG, fds.size() - i);
+        char byte = 0;
+        struct iovec iov = {&byte, 1};
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * n));
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n);
+        memcpy(CMSG_DATA(cmsg), &fds[i], sizeof(int) * n);
+        if (sendmsg(sock, &msg, MSG_NOSIGNAL) != 1) return false;
+    }
+    return true;
+}
+
+inline bool recvFds(int sock, std::vector<int>& fds) {
+    char count[4];
+    if (!readAll(sock, count, sizeof(count))) return false;
+    size_t total = getU32(count);
+    fds.clear();
+    while (fds.size() < total) {
+        size_t n = std::min<size_t>(HANDOFF_FDS_PER_MSG, total - fds.size());
+        char byte;
+        struct iovec iov = {&byte, 1};
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * n));
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        if (recvmsg(sock, &msg, 0) != 1) return false;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return false;
+        size_t got = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t at = fds.size();
+        fds.resize(at + got);
+        memcpy(&fds[at], CMSG_DATA(cmsg), sizeof(int) * got);
+    }
+    return true;
+}
+
+inline bool sendBlob(int sock, const std::string& blob) {
+    std::string length;
+    putU32(length, static_cast<uint32_t>(blob.size()));
+    return writeAll(sock, length.data(), length.size()) &&
+           writeAll(sock, blob.data(), blob.size());
+}
+
+inline bool recvBlob(int sock, std::string& blob) {
+    char length[4];
+    if (!readAll(sock, length, sizeof(length))) return false;
+    blob.resize(getU32(length));
+    return readAll(sock, &blob[0], blob.size());
+}
+
+inline void putU64(std::string& out, uint64_t v) {
+    putU32(out, static_cast<uint32_t>(v >> 32));
+    putU32(out, static_cast<uint32_t>(v));
+}
+
+inline void putI32(std::string& out, int v) {
+    putU32(out, static_cast<uint32_t>(v));
+}
+
+// Bounds-checked cursor over a snapshot; throws on truncation.
+class Reader {
+private:
+    const char* p;
+    const char* end;
+
+public:
+    Reader(const char* data, size_t length) : p(data), end(data + length) {}
+
+    const char* take(size_t n) {
+        if (static_cast<size_t>(end - p) < n) throw std::runtime_error("truncated snapshot");
+        const char* at = p;
+        p += n;
+        return at;
+    }
+
+    uint8_t u8() { return static_cast<uint8_t>(*take(1)); }
+    uint32_t u32() { return getU32(take(4)); }
+    int i32() { return static_cast<int32_t>(u32()); }
+    uint64_t u64() {
+        uint64_t hi = u32();
+        return hi << 32 | u32();
+    }
+};
+
+inline void putString(std::string& out, const std::string& text) {
+    putU32(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+inline std::string getString(Reader& in) {
+    uint32_t length = in.u32();
+    return std::string(in.take(length), length);
+}
+
+// Board cells go one byte each; bitboards are rebuilt on load. Trail ages
+// (decay rules only) follow the cells, or a zero count when not kept.
+inline void encodeSim(const SimState& s, std::string& out) {
+    putI32(out, s.width);
+    putI32(out, s.height);
+    putI32(out, s.tickMs);
+    putI32(out, s.respawnDelayMs);
+    putI32(out, s.survivalPoints);
+    putI32(out, s.killPoints);
+    uint64_t rateBits;
+    memcpy(&rateBits, &s.transferRate, sizeof(rateBits));
+    putU64(out, rateBits);
+    putU64(out, s.tick);
+    putU64(out, s.rng);
+    for (int cell : s.cells) {
+        out.push_back(static_cast<char>(cell));
+    }
+    putU32(out, static_cast<uint32_t>(s.cellTick.size()));
+    for (uint64_t laid : s.cellTick) {
+        putU64(out, laid);
+    }
+    putU32(out, static_cast<uint32_t>(s.players.size()));
+    for (const auto& p : s.players) {
+        putI32(out, p.id);
+        putI32(out, p.playerIndex);
+        putI32(out, p.colorIndex);
+        putI32(out, p.x);
+        putI32(out, p.y);
+        putI32(out, p.dx);
+        putI32(out, p.dy);
+        out.push_back(static_cast<char>(p.alive));
+        putI32(out, p.score);
+        putI32(out, p.highScore);
+        putI32(out, p.aliveMs);
+        putU64(out, p.respawnTick);
+        putI32(out, p.botLevel);
+    }
+}
+
+inline void decodeSim(Reader& in, SimState& s) {
+    int width = in.i32();
+    int height = in.i32();
+    if (width <= 0 || height <= 0 || width > MAX_BOARD_SIDE || height > MAX_BOARD_SIDE) {
+        throw std::runtime_error("bad board size in snapshot");
+    }
+    simInit(s, 0, width, height);
+    s.tickMs = in.i32();
+    s.respawnDelayMs = in.i32();
+    if (s.tickMs <= 0 || s.respawnDelayMs < 0) throw std::runtime_error("bad timing in snapshot");
+    s.survivalPoints = in.i32();
+    s.killPoints = in.i32();
+    uint64_t rateBits = in.u64();
+    memcpy(&s.transferRate, &rateBits, sizeof(rateBits));
+    s.tick = in.u64();
+    s.rng = in.u64();
+    const char* cells = in.take(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int value = static_cast<uint8_t>(cells[y * width + x]);
+            if (value > MAX_PLAYERS) throw std::runtime_error("bad cell in snapshot");
+            if (value) simSetCell(s, x, y, value);
+        }
+    }
+    uint32_t ages = in.u32();
+    if (ages && ages != s.cells.size()) throw std::runtime_error("bad trail ages in snapshot");
+    s.cellTick.resize(ages);
+    for (auto& laid : s.cellTick) {
+        laid = in.u64();
+    }
+    uint32_t count = in.u32();
+    if (count > MAX_PLAYERS) throw std::runtime_error("too many players in snapshot");
+    for (uint32_t i = 0; i < count; i++) {
+        SimPlayer p = {};
+        p.id = in.i32();
+        p.playerIndex = in.i32();
+        p.colorIndex = in.i32();
+        p.x = in.i32();
+        p.y = in.i32();
+        p.dx = in.i32();
+        p.dy = in.i32();
+        p.alive = in.u8() != 0;
+        p.score = in.i32();
+        p.highScore = in.i32();
+        p.aliveMs = in.i32();
+        p.respawnTick = in.u64();
+        p.botLevel = in.i32();
+        if (p.colorIndex < 0 || p.colorIndex >= MAX_PLAYERS ||
+            p.playerIndex < 0 || p.playerIndex >= MAX_PLAYERS) {
+            throw std::runtime_error("bad player in snapshot");
+        }
+        s.players.push_back(p);
+    }
+}
+
+}  // namespace handoff
+
+#endif
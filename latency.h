@@ -0,0 +1,100 @@
+#ifndef TRON_LATENCY_H
+#define TRON_LATENCY_H
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "config.h"
+#include "udp_transport.h"
+
+// Link quality from timestamped heartbeats. Both ends ping: a MSG_HEARTBEAT
+// carries [u32 seq][u64 sender's monotonic us] and the peer echoes the payload
+// unchanged in a MSG_HEARTBEAT_ACK. The sender keeps the last PING_WINDOW
+// pings and derives RTT, jitter (mean change between consecutive RTTs) and
+// loss (pings unanswered after PING_LOSS_MS) from them. Fixed size, no
+// allocation, so it can live in a per-connection struct and run in the tick.
+constexpr size_t PING_PAYLOAD_SIZE = 12;
+
+inline uint64_t monotonicUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LinkStats {
+    int samples = 0;            // answered pings in the window
+    double rttMs = 0;           // mean
+    double minRttMs = 0;
+    double jitterMs = 0;
+    double lossPct = 0;
+};
+
+class PingWindow {
+private:
+    struct Slot {
+        uint32_t seq;           // 0 = unused
+        uint64_t sentUs;
+        uint64_t rttUs;
+        bool answered;
+    };
+
+    Slot slots[PING_WINDOW] = {};
+    uint32_t nextSeq = 1;
+
+public:
+    uint32_t sent() const { return nextSeq - 1; }
+
+    void makePing(uint64_t nowUs, char* payload) {
+        uint32_t seq = nextSeq++;
+        slots[seq % PING_WINDOW] = {seq, nowUs, 0, false};
+        for (int i = 0; i < 4; i++) payload[i] = static_cast<char>(seq >> (24 - 8 * i));
+        for (int i = 0; i < 8; i++) payload[4 + i] = static_cast<char>(nowUs >> (56 - 8 * i));
+    }
+
+    // False for echoes that are short, duplicated or fell out of the window.
+    bool onAck(const char* payload, size_t length, uint64_t nowUs) {
+        if (length < PING_PAYLOAD_SIZE) return false;
+        uint32_t seq = getU32(payload);
+        Slot& slot = slots[seq % PING_WINDOW];
+        if (!seq || slot.seq != seq || slot.answered) return false;
+        uint64_t echoedUs = (uint64_t(getU32(payload + 4)) << 32) | getU32(payload + 8);
+        if (echoedUs != slot.sentUs || nowUs < echoedUs) return false;
+        slot.rttUs = nowUs - echoedUs;
+        slot.answered = true;
+        return true;
+    }
+
+    LinkStats stats(uint64_t nowUs) const {
+        LinkStats s;
+        uint64_t total = 0, minRtt = UINT64_MAX, jitter = 0;
+        int lost = 0, steps = 0;
+        bool havePrev = false;
+        uint64_t prev = 0;
+        uint32_t first = nextSeq > PING_WINDOW ? nextSeq - PING_WINDOW : 1;
+        for (uint32_t seq = first; seq < nextSeq; seq++) {
+            const Slot& slot = slots[seq % PING_WINDOW];
+            if (slot.seq != seq) continue;
+            if (!slot.answered) {
+                if (nowUs - slot.sentUs > uint64_t(PING_LOSS_MS) * 1000) lost++;
+                continue;
+            }
+            s.samples++;
+            total += slot.rttUs;
+            minRtt = std::min(minRtt, slot.rttUs);
+            if (havePrev) {
+                jitter += slot.rttUs > prev ? slot.rttUs - prev : prev - slot.rttUs;
+                steps++;
+            }
+            prev = slot.rttUs;
+            havePrev = true;
+        }
+        if (s.samples) {
+            s.rttMs = total / 1000.0 / s.samples;
+            s.minRttMs = minRtt / 1000.0;
+        }
+        if (steps) s.jitterMs = jitter / 1000.0 / steps;
+        if (s.samples + lost) s.lossPct = 100.0 * lost / (s.samples + lost);
+        return s;
+    }
+};
+
+#endif
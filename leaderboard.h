@@ -0,0 +1,216 @@
+#ifndef TRON_LEADERBOARD_H
+#define TRON_LEADERBOARD_H
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+// Process-wide best-score ranking shared by every room. Rooms submit scores
+// into a small pending batch; the batch is folded into an order-statistic
+// treap (each node knows its subtree size) on the next flush, so rank, top-K
+// and neighbour queries cost O(log n) however many players are on record.
+// Rank 1 is the highest score; equal scores are ordered by id. Ids are the
+// players' stats keys (stats::keyForName), so a rank survives reconnects.
+class Leaderboard {
+public:
+    struct Entry {
+        int64_t id;
+        int score;
+    };
+
+private:
+    struct Node {
+        int score;
+        int64_t id;
+        uint32_t priority;
+        int left, right, size;
+    };
+
+    std::vector<Node> nodes;             // nodes[0] is the empty tree
+    std::unordered_map<int64_t, int> nodeOf;
+    int root = 0;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    mutable std::mutex treeMutex;
+
+    std::mutex pendingMutex;
+    std::vector<Entry> pending;
+    std::vector<Entry> applying;
+
+    static bool before(const Node& n, int score, int64_t id) {
+        return n.score > score || (n.score == score && n.id < id);
+    }
+
+    void update(int t) {
+        nodes[t].size = 1 + nodes[nodes[t].left].size + nodes[nodes[t].right].size;
+    }
+
+    // Splits t into the entries ranked before (score, id) and the rest.
+    void split(int t, int score, int64_t id, int& l, int& r) {
+        if (!t) {
+            l = r = 0;
+            return;
+        }
+        if (before(nodes[t], score, id)) {
+            split(nodes[t].right, score, id, nodes[t].right, r);
+            l = t;
+        } else {
+            split(nodes[t].left, score, id, l, nodes[t].left);
+            r = t;
+        }
+        update(t);
+    }
+
+    int merge(int l, int r) {
+        if (!l || !r) return l ? l : r;
+        if (nodes[l].priority > nodes[r].priority) {
+            int right = merge(nodes[l].right, r);
+            nodes[l].right = right;
+            update(l);
+            return l;
+        }
+        int left = merge(l, nodes[r].left);
+        nodes[r].left = left;
+        update(r);
+        return r;
+    }
+
+    int erase(int t, int score, int64_t id) {
+        if (nodes[t].id == id) return merge(nodes[t].left, nodes[t].right);
+        if (before(nodes[t], score, id)) {
+            int right = erase(nodes[t].right, score, id);
+            nodes[t].right = right;
+        } else {
+            int left = erase(nodes[t].left, score, id);
+            nodes[t].left = left;
+        }
+        update(t);
+        return t;
+    }
+
+    uint32_t nextPriority() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return static_cast<uint32_t>(rng);
+    }
+
+    // Keeps the better of the stored and the submitted score.
+    void apply(int64_t id, int score) {
+        auto it = nodeOf.find(id);
+        int t;
+        if (it != nodeOf.end()) {
+            t = it->second;
+            if (nodes[t].score >= score) return;
+            root = erase(root, nodes[t].score, id);
+        } else {
+            t = static_cast<int>(nodes.size());
+            nodes.push_back({});
+            nodeOf[id] = t;
+        }
+        nodes[t] = {score, id, nextPriority(), 0, 0, 1};
+        int l, r;
+        split(root, score, id, l, r);
+        root = merge(merge(l, t), r);
+    }
+
+    // Zero-based position of (score, id), which must be in the tree.
+    int position(int score, int64_t id) const {
+        int count = 0;
+        int t = root;
+        while (t) {
+            if (before(nodes[t], score, id)) {
+                count += nodes[nodes[t].left].size + 1;
+                t = nodes[t].right;
+            } else if (nodes[t].id == id) {
+                return count + nodes[nodes[t].left].size;
+            } else {
+                t = nodes[t].left;
+            }
+        }
+        return count;
+    }
+
+    int nodeAt(int index) const {
+        int t = root;
+        while (t) {
+            int leftSize = nodes[nodes[t].left].size;
+            if (index < leftSize) {
+                t = nodes[t].left;
+            } else if (index == leftSize) {
+                return t;
+            } else {
+                index -= leftSize + 1;
+                t = nodes[t].right;
+            }
+        }
+        return 0;
+    }
+
+    void collect(int from, int count, std::vector<Entry>& out) const {
+        for (int i = from; i < from + count; i++) {
+            const Node& n = nodes[nodeAt(i)];
+            out.push_back({n.id, n.score});
+        }
+    }
+
+public:
+    Leaderboard() : nodes(1, Node{0, 0, 0, 0, 0, 0}) {}
+
+    // Cheap enough to call from a room thread per event; takes effect on flush().
+    void submit(int64_t id, int score) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back({id, score});
+    }
+
+    void flush() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if (pending.empty()) return;
+            applying.swap(pending);
+        }
+        std::lock_guard<std::mutex> lock(treeMutex);
+        for (const auto& e : applying) {
+            apply(e.id, e.score);
+        }
+        applying.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(treeMutex);
+        return nodes[root].size;
+    }
+
+    // 1-based rank, 0 when the id has no score on record.
+    int rankOf(int64_t id) const {
+        std::lock_guard<std::mutex> lock(treeMutex);
+        auto it = nodeOf.find(id);
+        if (it == nodeOf.end()) return 0;
+        const Node& n = nodes[it->second];
+        return position(n.score, n.id) + 1;
+    }
+
+    std::vector<Entry> top(int k) const {
+        std::lock_guard<std::mutex> lock(treeMutex);
+        std::vector<Entry> out;
+        collect(0, std::min(k, nodes[root].size), out);
+        return out;
+    }
+
+    // Up to `radius` entries on each side of id, id included.
+    std::vector<Entry> around(int64_t id, int radius) const {
+        std::lock_guard<std::mutex> lock(treeMutex);
+        std::vector<Entry> out;
+        auto it = nodeOf.find(id);
+        if (it == nodeOf.end()) return out;
+        const Node& n = nodes[it->second];
+        int at = position(n.score, n.id);
+        int from = std::max(0, at - radius);
+        int to = std::min(nodes[root].size, at + radius + 1);
+        collect(from, to - from, out);
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef TRON_PROTOCOL_H
+#define TRON_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "config.h"
+#include "compress.h"
+
+// Every message on the wire is [u32 payload length, big endian][u8 type][payload].
+enum MessageType : uint8_t {
+    MSG_INDEX = 1,
+    MSG_STATE = 2,
+    MSG_INPUT = 3,
+    MSG_HEARTBEAT = 4,      // empty, or a ping: [u32 seq BE][u64 sender us BE]
+    MSG_HELLO = 5,          // [u8 codec mask][player name, client to server; none = anonymous]
+    MSG_COMPRESSED = 6,     // [u8 codec][u8 inner type][u32 raw length BE][data]
+    MSG_VIEWPORT = 7,       // [u16 cols BE][u16 rows BE] of board the client can show
+    MSG_INPUT_AT = 8,       // [u32 tick BE of the state the player saw][keys]
+    MSG_JOIN = 9,           // [u32 room BE], first frame only; routes the connection to its room
+    MSG_HEARTBEAT_ACK = 10, // a ping's payload, echoed unchanged
+};
+
+inline void writeFrameHeader(char* header, MessageType type, uint32_t length) {
+    header[0] = static_cast<char>((length >> 24) & 0xFF);
+    header[1] = static_cast<char>((length >> 16) & 0xFF);
+    header[2] = static_cast<char>((length >> 8) & 0xFF);
+    header[3] = static_cast<char>(length & 0xFF);
+    header[4] = static_cast<char>(type);
+}
+
+inline void appendFrameHeader(std::string& out, MessageType type, uint32_t length) {
+    char header[FRAME_HEADER_SIZE];
+    writeFrameHeader(header, type, length);
+    out.append(header, FRAME_HEADER_SIZE);
+}
+
+inline std::string encodeFrame(MessageType type, const char* data, size_t length) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + length);
+    appendFrameHeader(frame, type, static_cast<uint32_t>(length));
+    frame.append(data, length);
+    return frame;
+}
+
+inline std::string encodeFrame(MessageType type, const std::string& payload) {
+    return encodeFrame(type, payload.data(), payload.size());
+}
+
+// For small frames on a socket with no send queue. A non-blocking socket may
+// take only part of a frame, and the peer would then read every later header
+// from the wrong offset, so anything short of the whole frame shuts the
+// connection down.
+inline bool sendAll(int sock, const char* data, size_t length) {
+    if (send(sock, data, length, MSG_NOSIGNAL) == static_cast<ssize_t>(length)) return true;
+    shutdown(sock, SHUT_RDWR);
+    return false;
+}
+
+inline bool sendFrame(int sock, MessageType type, const char* data, size_t length) {
+    std::string frame = encodeFrame(type, data, length);
+    return sendAll(sock, frame.data(), frame.size());
+}
+
+inline void appendCompressedFrame(std::string& frame, uint8_t codec, MessageType inner,
+                                  const std::string& compressed, size_t rawLength) {
+    appendFrameHeader(frame, MSG_COMPRESSED, static_cast<uint32_t>(6 + compressed.size()));
+    frame.push_back(static_cast<char>(codec));
+    frame.push_back(static_cast<char>(inner));
+    frame.push_back(static_cast<char>((rawLength >> 24) & 0xFF));
+    frame.push_back(static_cast<char>((rawLength >> 16) & 0xFF));
+    frame.push_back(static_cast<char>((rawLength >> 8) & 0xFF));
+    frame.push_back(static_cast<char>(rawLength & 0xFF));
+    frame.append(compressed);
+}
+
+// Unwraps a MSG_COMPRESSED payload into its inner type and raw bytes.
+inline void decodeCompressedFrame(const char* data, size_t length,
+                                  MessageType& inner, std::string& out) {
+    if (length < 6) throw std::runtime_error("short compressed frame");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    inner = static_cast<MessageType>(p[1]);
+    size_t rawLength = (size_t(p[2]) << 24) | (size_t(p[3]) << 16) | (size_t(p[4]) << 8) | p[5];
+    decompressPayload(p[0], data + 6, length - 6, out, rawLength);
+}
+
+// Incremental frame parser over a power-of-two ring buffer. Bytes are received
+// straight into the free space of the ring and each byte is inspected once;
+// nothing is shifted when a frame is consumed. The ring grows when a header
+// announces a frame larger than the current capacity, up to MAX_FRAME_SIZE.
+class FrameParser {
+private:
+    std::vector<char> ring;
+    std::vector<char> scratch;
+    size_t mask;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t cap = 1;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    void copyOut(uint64_t from, char* dst, size_t length) const {
+        size_t start = from & mask;
+        size_t first = std::min(length, ring.size() - start);
+        memcpy(dst, &ring[start], first);
+        memcpy(dst + first, &ring[0], length - first);
+    }
+
+    void grow(size_t minCapacity) {
+        std::vector<char> bigger(roundUpPow2(minCapacity));
+        size_t used = tail - head;
+        copyOut(head, bigger.data(), used);
+        ring.swap(bigger);
+        mask = ring.size() - 1;
+        head = 0;
+        tail = used;
+    }
+
+public:
+    explicit FrameParser(size_t capacity = MAX_DATA_BUFFER)
+        : ring(roundUpPow2(capacity)), mask(ring.size() - 1) {}
+
+    size_t buffered() const { return tail - head; }
+    size_t capacity() const { return ring.size(); }
+
+    // Receives into the ring's free space with a single readv; returns its result.
+    ssize_t readFrom(int sock) {
+        if (buffered() == ring.size()) {
+            grow(ring.size() * 2);
+        }
+        size_t start = tail & mask;
+        size_t freeBytes = ring.size() - buffered();
+        size_t first = std::min(freeBytes, ring.size() - start);
+
+        struct iovec iov[2];
+        iov[0].iov_base = &ring[start];
+        iov[0].iov_len = first;
+        iov[1].iov_base = &ring[0];
+        iov[1].iov_len = freeBytes - first;
+
+        ssize_t n = readv(sock, iov, iov[1].iov_len ? 2 : 1);
+        if (n > 0) tail += n;
+        return n;
+    }
+
+    void append(const char* data, size_t length) {
+        if (buffered() + length > ring.size()) {
+            grow(buffered() + length);
+        }
+        size_t start = tail & mask;
+        size_t first = std::min(length, ring.size() - start);
+        memcpy(&ring[start], data, first);
+        memcpy(&ring[0], data + first, length - first);
+        tail += length;
+    }
+
+    // Moves everything received but not yet consumed into out.
+    void takeBuffered(std::string& out) {
+        out.resize(buffered());
+        copyOut(head, &out[0], out.size());
+        head = tail;
+    }
+
+    // Pops the next complete frame. The payload pointer stays valid until the
+    // next call to readFrom, append or next.
+    bool next(MessageType& type, const char*& data, size_t& length) {
+        if (buffered() < FRAME_HEADER_SIZE) return false;
+
+        unsigned char header[FRAME_HEADER_SIZE];
+        copyOut(head, reinterpret_cast<char*>(header), FRAME_HEADER_SIZE);
+        uint32_t payloadLength = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) |
+                                 (uint32_t(header[2]) << 8) | uint32_t(header[3]);
+        if (payloadLength > MAX_FRAME_SIZE) {
+            throw std::runtime_error("Frame exceeds MAX_FRAME_SIZE");
+        }
+
+        size_t frameLength = FRAME_HEADER_SIZE + payloadLength;
+        if (frameLength > ring.size()) {
+            grow(frameLength);
+        }
+        if (buffered() < frameLength) return false;
+
+        uint64_t payloadPos = head + FRAME_HEADER_SIZE;
+        size_t start = payloadPos & mask;
+        if (start + payloadLength <= ring.size()) {
+            data = &ring[start];
+        } else {
+            if (scratch.size() < payloadLength) scratch.resize(payloadLength);
+            copyOut(payloadPos, scratch.data(), payloadLength);
+            data = scratch.data();
+        }
+        type = static_cast<MessageType>(header[4]);
+        length = payloadLength;
+        head += frameLength;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include "config.h"
+#include "tron_sim.h"
+
+// Headless batch runner: steps many independent games across all cores with
+// no sockets and no sleeping, then reports simulation throughput. Deaths into
+// the player's own trail are counted apart, and so are those where another
+// cell was open; with --max-own-trail the run fails when the avoidable ones
+// make up more than that share of all deaths, which is how `make check`
+// holds the bots to each mode's rules.
+
+struct SelfPlayOptions {
+    std::string mode = "classic";
+    int games = 1000;
+    int ticks = 1000;
+    int threads = 0;
+    int level = 0;           // 0: random turns, otherwise a bot level
+    uint64_t seed = 1;
+    double maxOwnTrail = -1; // percent of deaths; negative: no limit
+};
+
+struct SelfPlayTotals {
+    uint64_t ticks = 0;
+    uint64_t deaths = 0;
+    uint64_t kills = 0;
+    uint64_t ownTrail = 0;
+    uint64_t avoidable = 0;     // own-trail deaths with another cell open
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [--mode M] [--games N] [--ticks N] [--threads N] [--level 0-" << BOT_MAX_DEPTH
+              << "] [--seed N] [--max-own-trail PCT]" << std::endl
+              << "  modes: classic wrap decay rounds" << std::endl;
+}
+
+static bool parseOptions(int argc, char** argv, SelfPlayOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (!strcmp(argv[i - 1], "--mode")) opt.mode = value;
+        else if (!strcmp(argv[i - 1], "--games")) opt.games = atoi(value);
+        else if (!strcmp(argv[i - 1], "--ticks")) opt.ticks = atoi(value);
+        else if (!strcmp(argv[i - 1], "--threads")) opt.threads = atoi(value);
+        else if (!strcmp(argv[i - 1], "--level")) opt.level = atoi(value);
+        else if (!strcmp(argv[i - 1], "--seed")) opt.seed = strtoull(value, nullptr, 10);
+        else if (!strcmp(argv[i - 1], "--max-own-trail")) opt.maxOwnTrail = atof(value);
+        else return false;
+    }
+    return opt.games > 0 && opt.ticks > 0 && opt.level >= 0 && opt.level <= BOT_MAX_DEPTH;
+}
+
+struct OwnTrailMove {
+    int id;
+    bool avoidable;
+};
+
+// Living players whose move this tick lands on their own trail, and whether
+// an empty cell was there to turn into instead.
+template <class Rules>
+static void findOwnTrailMoves(const SimState& sim, const std::vector<SimInput>& inputs,
+                              std::vector<OwnTrailMove>& moves) {
+    static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    moves.clear();
+    for (const auto& p : sim.players) {
+        if (!p.alive) continue;
+        SimPlayer moved = p;
+        for (const auto& input : inputs) {
+            if (input.playerId == p.id) simApplyInput(moved, input.key);
+        }
+        int x = moved.x + moved.dx, y = moved.y + moved.dy;
+        if (!Rules::Edges::step(sim, x, y) || sim.cell(x, y) != p.colorIndex + 1) continue;
+        bool avoidable = false;
+        for (const auto& d : dirs) {
+            if (d[0] == -p.dx && d[1] == -p.dy) continue;
+            int ox = p.x + d[0], oy = p.y + d[1];
+            if (Rules::Edges::step(sim, ox, oy) && sim.cell(ox, oy) == 0) avoidable = true;
+        }
+        moves.push_back({p.id, avoidable});
+    }
+}
+
+template <class Rules>
+static void runGame(const SelfPlayOptions& opt, uint64_t seed, SimBotDriver<Rules>& bots,
+                    std::vector<SimInput>& inputs, std::vector<SimEvent>& events,
+                    SelfPlayTotals& totals) {
+    SimState sim;
+    simInit(sim, seed);
+    for (int id = 0; id < MAX_PLAYERS; id++) {
+        simAddPlayer(sim, id, 0, opt.level, events);
+    }
+
+    static const char keys[4] = {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT};
+    std::vector<OwnTrailMove> ownTrailMoves;
+    for (int t = 0; t < opt.ticks; t++) {
+        inputs.clear();
+        events.clear();
+        if (opt.level > 0) {
+            bots.decide(sim, inputs);
+        } else {
+            for (const auto& p : sim.players) {
+                uint64_t r = simRandom(sim);
+                if ((r & 7) == 0) inputs.push_back({p.id, keys[(r >> 3) & 3]});
+            }
+        }
+        findOwnTrailMoves<Rules>(sim, inputs, ownTrailMoves);
+        simStep<Rules>(sim, inputs.data(), inputs.size(), events);
+        for (const auto& e : events) {
+            if (e.type != SIM_EVENT_DEATH) continue;
+            totals.deaths++;
+            if (e.killerId != SIM_NO_PLAYER) {
+                totals.kills++;
+                continue;
+            }
+            for (const auto& m : ownTrailMoves) {
+                if (m.id != e.playerId) continue;
+                totals.ownTrail++;
+                totals.avoidable += m.avoidable;
+            }
+        }
+    }
+    totals.ticks += opt.ticks;
+}
+
+template <class Rules>
+static void runGames(const SelfPlayOptions& opt, std::vector<SelfPlayTotals>& totals) {
+    std::atomic<int> nextGame{0};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < opt.threads; w++) {
+        workers.emplace_back([&opt, &nextGame, &totals, w]() {
+            SimBotDriver<Rules> bots;
+            std::vector<SimInput> inputs;
+            std::vector<SimEvent> events;
+            int game;
+            while ((game = nextGame.fetch_add(1)) < opt.games) {
+                runGame(opt, opt.seed + game, bots, inputs, events, totals[w]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+struct SelfPlayMode {
+    const char* name;
+    void (*run)(const SelfPlayOptions&, std::vector<SelfPlayTotals>&);
+};
+
+static const SelfPlayMode modes[] = {
+    {"classic", runGames<ClassicRules>},
+    {"wrap", runGames<WrapRules>},
+    {"decay", runGames<DecayRules>},
+    {"rounds", runGames<RoundsRules>},
+};
+
+int main(int argc, char** argv) {
+    SelfPlayOptions opt;
+    const SelfPlayMode* mode = nullptr;
+    bool parsed = parseOptions(argc, argv, opt);
+    for (const auto& m : modes) {
+        if (opt.mode == m.name) mode = &m;
+    }
+    if (!parsed || !mode) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.threads <= 0) {
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<SelfPlayTotals> totals(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    mode->run(opt, totals);
+
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    SelfPlayTotals sum;
+    for (const auto& t : totals) {
+        sum.ticks += t.ticks;
+        sum.deaths += t.deaths;
+        sum.kills += t.kills;
+        sum.ownTrail += t.ownTrail;
+        sum.avoidable += t.avoidable;
+    }
+    double avoidablePct = sum.deaths ? 100.0 * sum.avoidable / sum.deaths : 0;
+
+    printf("mode:%s games:%d threads:%d level:%d\n", opt.mode.c_str(), opt.games, opt.threads,
+           opt.level);
+    printf("ticks:%llu deaths:%llu kills:%llu own_trail:%llu avoidable:%llu (%.1f%%)\n",
+           (unsigned long long)sum.ticks, (unsigned long long)sum.deaths,
+           (unsigned long long)sum.kills, (unsigned long long)sum.ownTrail,
+           (unsigned long long)sum.avoidable, avoidablePct);
+    printf("elapsed:%.3fs throughput:%.0f ticks/s\n", seconds, sum.ticks / seconds);
+    if (opt.maxOwnTrail >= 0 && avoidablePct > opt.maxOwnTrail) {
+        printf("FAIL: avoidable own-trail deaths above %.1f%%\n", opt.maxOwnTrail);
+        return 1;
+    }
+    return 0;
+}
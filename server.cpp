@@ -1,5 +1,6 @@
 #include <map>          
 #include <mutex>        
+#include <atomic>       
 #include <locale>       
 #include <thread>       
 #include <vector>      
@@ -7,14 +8,34 @@
 #include <fcntl.h>      
 #include <errno.h>      
 #include <codecvt>      
-#include <fstream>      
+#include <sstream>
 #include <cstring>      
 #include <unistd.h>     
 #include <iostream>      
+#include <algorithm>     
+#include <charconv>      
 #include <sys/socket.h> 
 #include <netinet/in.h> 
-#include <sys/select.h> 
+#include <sys/ioctl.h>  
+#include <arpa/inet.h>  
+#include <sys/un.h>     
+#include <sys/stat.h>
+#include <poll.h>
 #include "config.h"    
+#include "protocol.h"  
+#include "timing_wheel.h"
+#include "udp_transport.h"
+#include "shm_ring.h"
+#include "viewport.h"
+#include "tron_sim.h" 
+#include "leaderboard.h"
+#include "alloc_stats.h"
+#include "handoff.h"
+#include "workers.h"
+#include "trace.h"
+#include "latency.h"
+#include "stats_store.h"
+#include "admin.h"
 
 #ifdef DEBUG_MODE
 #define DEBUG_LOG(msg, ...) printf("[DEBUG] " msg "\n", ##__VA_ARGS__)
@@ -22,504 +43,1250 @@
 #define DEBUG_LOG(msg, ...)
 #endif
 
-struct Player {
-    int x, y;            
-    int dx, dy;          
-    bool alive;          
-    int socket;          
-    int playerIndex;     
-    int score;           
-    int highScore;       
-    time_t lastScoreTime;
-    int colorIndex;      
+struct Connection {
+    int socket;                          // TCP fd, or the session id for UDP
+    TimingWheel::TimerId idleTimer;      
+    TimingWheel::TimerId heartbeatTimer; 
+    uint8_t codecs;                      // negotiated in MSG_HELLO, 0 = plain text
+    bool udp;
+    sockaddr_in peer;
+    uint32_t nonce;
+    uint32_t stateSeq;
+    uint32_t inputSeq;                   // next UDP input sequence expected
+    int viewW, viewH;                    // reported viewport, 0 = whole board
+    std::string unread;                  // bytes a parked connection thread had not parsed
+    std::string outbox;                  // written frames the socket has not taken yet
+    bool starting = false;               // admitted; output waits for its connection thread
+    PingWindow ping;                     // our heartbeats to this client
+    uint64_t lifeStart = 0;              // tick of the last spawn, for survival stats
+    int64_t statsKey = 0;                // hash of the name sent in HELLO, 0 = anonymous
 };
 
+// Stats key for the name a client sent; longer names are cut, not refused.
+static int64_t nameKey(const char* name, size_t length) {
+    return stats::keyForName(name, std::min<size_t>(length, PLAYER_NAME_MAX_LENGTH));
+}
+
+static bool samePeer(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+// Number formatting for the state text without std::to_string temporaries.
+static void appendNumber(std::string& out, long long value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr - buf);
+}
+
+static void appendHex(std::string& out, uint64_t value) {
+    char buf[16];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, 16);
+    out.append(buf, result.ptr - buf);
+}
+
+// "a,b,c\n"
+static void appendList(std::string& out, std::initializer_list<long long> values) {
+    const char* sep = "";
+    for (long long v : values) {
+        out += sep;
+        appendNumber(out, v);
+        sep = ",";
+    }
+    out += '\n';
+}
+
+// One simulated tick as it last ran: the state before it and what it consumed
+// and produced, kept so a late input can be slotted in and the tick rerun.
+struct TickRecord {
+    SimState before;
+    std::vector<SimInput> inputs;
+    std::vector<SimEvent> events;
+};
+
+struct LateInput {
+    uint64_t tick;
+    SimInput input;
+};
+
+enum TimerKind {
+    TIMER_IDLE,
+    TIMER_HEARTBEAT,
+};
+
+// One room. Rules (see tron_sim.h) are fixed per instantiation, so each game
+// mode gets its own tick code and the classic mode pays nothing for the rest.
+template <class Rules>
 class TronGame {
 private:
-    std::vector<std::vector<int>> board;    
-    std::vector<Player> players;            
+    SimState sim;                           
+    std::string mode;                       // game mode name, checked on takeover
+    std::vector<Connection> connections;    
+    std::vector<SimInput> pendingInputs;    
+    std::vector<SimEvent> events;           
     std::mutex gameMutex;                   
     bool gameRunning;                       
-    std::map<int, int> highScores;          
-    std::vector<bool> usedPlayerIndices;    
-    std::vector<bool> usedColorIndices;     
-    std::map<int, int> socketToHighScores;  
-
-    struct PlayerScore {
-        int current;     
-        int high;        
-        int colorIndex;  
-    };
-    std::map<int, PlayerScore> playerScores;  
-
-    bool isSafePosition(int x, int y) {
-        for (int i = -INIT_SPACE_CHECK; i <= INIT_SPACE_CHECK; i++) {
-            for (int j = -INIT_SPACE_CHECK; j <= INIT_SPACE_CHECK; j++) {
-                int checkX = x + i;
-                int checkY = y + j;
-                if (checkX >= 0 && checkX < BOARD_WIDTH &&
-                    checkY >= 0 && checkY < BOARD_HEIGHT &&
-                    board[checkY][checkX] != 0) {
-                    return false;
+    std::atomic<bool> handingOff{false};    
+    std::atomic<bool> draining{false};      // admin: turn new joins away
+    bool botsEnabled = BOTS_ENABLED;        
+    bool spectatorsEnabled = true;          // admin: publish to the shm ring
+    int rankScope = 0;                      // worker + 1 when ranks cover only this worker
+    uint64_t ringDrops = 0;                 // frames too large for a ring slot
+    uint64_t botBudgetUs = BOT_TICK_BUDGET_US;
+    stats::Store playerStats;               
+    uint64_t seedSlot = 0;                  // next stats slot to feed the leaderboard
+    uint64_t seedLayout = 0;                
+    bool seeded = false;                    
+    uint64_t nextStatsSync = 0;             
+    Leaderboard& leaderboard;               
+    TimingWheel timers;                     
+    SimBotDriver<Rules> bots;                   
+    int nextBotId = -1;                     
+    int nextUdpId = UDP_SESSION_BASE;       
+    int udpSocket = -1;                     
+    ShmFrameWriter frameRing;               
+    std::vector<int> minimap;               
+    std::string stateText;                  // per-tick scratch, cleared but never freed
+    std::string packedText;                 
+    std::string windowedFrame;              
+    std::string sharedFrames[(CODEC_RLE | CODEC_LZ | CODEC_DEFLATE) + 1];
+    AllocStats tickAllocs;                  
+    TickRecord history[LAG_COMP_TICKS];     
+    uint64_t historyStart = 0;              
+    std::vector<LateInput> lateInputs;      
+    std::vector<SimEvent> replayEvents;     
+    uint64_t rewinds = 0;                   
+    std::mutex joinMutex;                   // guards joinQueue only
+    std::vector<int> joinQueue;             // accepted, waiting for the next tick
+    std::vector<int> admitting;             
+    std::vector<int> admitted;              // joined this tick, need a connection thread
+    std::vector<int> turnedAway;            // no slot; closed once the tick lock is released
+
+    // Startup maps the stats file and reads nothing else. A file in an older
+    // format (records keyed on connection fds) is moved aside, not read. The
+    // leaderboard is fed from the table a slice per tick by seedLeaderboard().
+    void openStats(int worker) {
+        std::string file = workers::workerPath(STATS_FILE, worker);
+        seedSlot = 0;
+        seeded = false;
+        bool created;
+        bool opened = playerStats.open(file, STATS_INITIAL_CAPACITY, created);
+        if (!opened && errno == EINVAL && rename(file.c_str(), (file + ".old").c_str()) == 0) {
+            std::cout << "Moved unreadable " << file << " to " << file << ".old" << std::endl;
+            opened = playerStats.open(file, STATS_INITIAL_CAPACITY, created);
+        }
+        if (!opened) {
+            std::cerr << "Player stats unavailable (" << file << "): " << strerror(errno) << std::endl;
+        }
+    }
+
+    void seedLeaderboard() {
+        if (seeded || playerStats.growing()) return;
+        TRACE_SCOPE("seedLeaderboard");
+        if (playerStats.layout() != seedLayout) {      // the table grew under the scan
+            seedLayout = playerStats.layout();
+            seedSlot = 0;
+        }
+        uint64_t capacity = playerStats.capacity();
+        uint64_t end = std::min<uint64_t>(capacity, seedSlot + STATS_SEED_PER_TICK);
+        for (; seedSlot < end; seedSlot++) {
+            const stats::Record& r = playerStats.slot(seedSlot);
+            if (r.used && r.highScore > 0) leaderboard.submit(r.id, r.highScore);
+        }
+        seeded = seedSlot >= capacity;
+    }
+
+    // Stats and leaderboard key of a player; 0 for bots and anonymous
+    // players, who are not kept.
+    int64_t statsKeyOf(int id) {
+        Connection* conn = findConnection(id);
+        return conn ? conn->statsKey : 0;
+    }
+
+    stats::Record* statsOf(int id) {
+        int64_t key = statsKeyOf(id);
+        return key ? playerStats.get(key) : nullptr;
+    }
+
+    // Ties a connection to its name's record the first time it gives one;
+    // the stored high score carries over into this session.
+    void identifyLocked(Connection& conn, int64_t key) {
+        if (!key || conn.statsKey) return;
+        conn.statsKey = key;
+        stats::Record* r = playerStats.get(key);
+        if (!r) return;
+        r->games++;
+        if (r->highScore > 0) leaderboard.submit(key, r->highScore);
+        SimPlayer* p = simFindPlayer(sim, conn.socket);
+        if (p && r->highScore > p->highScore) {
+            p->highScore = r->highScore;
+            invalidateHistory();
+        }
+    }
+
+    // Banks the time a player has been alive since joining or respawning.
+    void creditSurvival(stats::Record& r, int id) {
+        Connection* conn = findConnection(id);
+        if (!conn) return;
+        r.survivalMs += (sim.tick - conn->lifeStart) * static_cast<uint64_t>(sim.tickMs);
+        conn->lifeStart = sim.tick;
+    }
+
+    // Appends the state text to `state`; nothing is allocated once the buffer
+    // has grown to frame size.
+    void serializeGameState(std::string& state, bool rle = false, 
+                            const ViewRect* view = nullptr) {	// DEBUG USE
+        ViewRect area = view ? *view : ViewRect{0, 0, sim.width, sim.height};
+        state += "STATUS:";
+        appendList(state, {gameRunning});
+        state += "TICK:";
+        appendList(state, {static_cast<long long>(sim.tick)});
+        // Whole-room hash, then the board part, which full-board clients recheck.
+        state += "HASH:";
+        appendHex(state, simHash(sim));
+        state += ',';
+        appendHex(state, sim.boardHash);
+        state += '\n';
+        state += "RANKED:";
+        appendList(state, {static_cast<long long>(leaderboard.size()), rankScope});
+        if (view) {
+            state += "VIEW:";
+            appendList(state, {area.x, area.y, area.w, area.h, sim.width, sim.height});
+        }
+        state += "PLAYERS\n";
+        for (const auto& player : sim.players) {
+            appendNumber(state, player.colorIndex);
+            state += ':';
+            int64_t key = statsKeyOf(player.id);
+            appendList(state, {player.playerIndex, player.score, player.highScore, player.alive,
+                               player.x, player.y, player.dx, player.dy,
+                               key ? leaderboard.rankOf(key) : 0});
+        }
+        state += "BOARD\n";
+        for (int y = area.y; y < area.y + area.h; y++) {
+            if (rle) {
+                appendRleRow(state, &sim.cells[y * sim.width + area.x], area.w);
+            } else {
+                for (int x = area.x; x < area.x + area.w; x++) {
+                    appendNumber(state, sim.cell(x, y));
+                    state += ',';
                 }
             }
+            state += '\n';
+        }
+        if (view) {
+            int mw, mh;
+            minimapSize(sim.width, sim.height, mw, mh);
+            if (minimap.empty()) buildMinimap(sim.cells.data(), sim.width, sim.height, minimap);
+            state += "MINIMAP:";
+            appendList(state, {mw, mh});
+            for (int y = 0; y < mh; y++) {
+                appendRleRow(state, &minimap[y * mw], mw);
+                state += '\n';
+            }
         }
-        return true;
     }
 
-    std::pair<int, int> getRandomSafePosition() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> disX(INIT_SPACE_CHECK, BOARD_WIDTH - INIT_SPACE_CHECK - 1);
-        std::uniform_int_distribution<> disY(INIT_SPACE_CHECK, BOARD_HEIGHT - INIT_SPACE_CHECK - 1);
-        std::uniform_int_distribution<> disDir(0, 3);
+    // Encodes into `frame`, reusing the room's text and compression buffers.
+    void encodeStateFrame(std::string& frame, uint8_t codecs, const ViewRect* view = nullptr) {
+        TRACE_SCOPE("serialize");
+        stateText.clear();
+        serializeGameState(stateText, codecs & CODEC_RLE, view);
+        frame.clear();
+        uint8_t codec = compressPayload(codecs, stateText, packedText);
+        if (codec) {
+            appendCompressedFrame(frame, codec, MSG_STATE, packedText, stateText.size());
+        } else {
+            appendFrameHeader(frame, MSG_STATE, static_cast<uint32_t>(stateText.size()));
+            frame += stateText;
+        }
+    }
 
-        for (int attempts = 0; attempts < 100; attempts++) {
-            int x = disX(gen);
-            int y = disY(gen);
-            if (isSafePosition(x, y)) {
-                return {x, y};
+    // Every TCP write goes through here. Whatever the socket does not take is
+    // kept in the outbox and goes out, in order, ahead of later frames, so a
+    // client never sees part of a frame followed by the start of another.
+    // A client that falls OUTBOX_MAX_BYTES behind is cut off; its connection
+    // thread then removes it as for any other hangup.
+    bool sendLocked(Connection& conn, const char* data, size_t length) {
+        if (conn.starting) return queueLocked(conn, data, length);
+        if (!flushLocked(conn)) return false;
+        if (conn.outbox.empty()) {
+            ssize_t n = send(conn.socket, data, length, MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                shutdown(conn.socket, SHUT_RDWR);
+                return false;
+            }
+            if (n > 0) {
+                data += n;
+                length -= n;
             }
+            if (!length) return true;
         }
-        throw std::runtime_error("Unable to find a safe starting position");
+        return queueLocked(conn, data, length);
     }
 
-    std::pair<int, int> getRandomDirection() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, 3);
-        int dir = dis(gen);
-        switch (dir) {
-            case 0: return {0, -1};  
-            case 1: return {0, 1};   
-            case 2: return {-1, 0};  
-            default: return {1, 0};  
+    bool queueLocked(Connection& conn, const char* data, size_t length) {
+        if (conn.outbox.size() + length > OUTBOX_MAX_BYTES) {
+            std::cerr << "Connection " << conn.socket << " fell too far behind" << std::endl;
+            conn.outbox.clear();
+            shutdown(conn.socket, SHUT_RDWR);
+            return false;
         }
+        conn.outbox.append(data, length);
+        return true;
     }
 
-    void loadHighScores() {
-        std::ifstream file(HIGH_SCORE_FILE);
-        int socket, score;
-        while (file >> socket >> score) {
-            socketToHighScores[socket] = score;
+    bool flushLocked(Connection& conn) {
+        if (conn.outbox.empty()) return true;
+        ssize_t n = send(conn.socket, conn.outbox.data(), conn.outbox.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            shutdown(conn.socket, SHUT_RDWR);
+            return false;
         }
+        conn.outbox.erase(0, n);
+        return true;
     }
 
-    void saveHighScores() {
-        std::ofstream file(HIGH_SCORE_FILE);
-        for (const auto& [socket, score] : playerScores) {
-            file << socket << " " << score.high << std::endl;
+    // Full-board frames are encoded at most once per codec combination and
+    // shared; connections with a viewport get their own window and minimap.
+    void broadcastState() {
+        TRACE_SCOPE("broadcast");
+        for (auto& frame : sharedFrames) frame.clear();
+        minimap.clear();
+        for (auto& c : connections) {
+            std::string* shared = &sharedFrames[c.codecs];
+            if (c.viewW) {
+                SimPlayer* p = simFindPlayer(sim, c.socket);
+                ViewRect view = viewAround(p ? p->x : sim.width / 2, p ? p->y : sim.height / 2,
+                                           c.viewW, c.viewH, sim.width, sim.height);
+                encodeStateFrame(windowedFrame, c.codecs, &view);
+                shared = &windowedFrame;
+            } else if (shared->empty()) {
+                encodeStateFrame(*shared, c.codecs);
+            }
+            const std::string& frame = *shared;
+            if (c.udp) {
+                sendUdpState(c, frame);
+                continue;
+            }
+            sendLocked(c, frame.data(), frame.size());
+        }
+        if (spectatorsEnabled && frameRing.isOpen()) {
+            std::string& frame = sharedFrames[CODEC_RLE];
+            if (frame.empty()) encodeStateFrame(frame, CODEC_RLE);
+            if (!frameRing.publish(frame.data(), frame.size())) {
+                ringDrops++;
+                if ((ringDrops & (ringDrops - 1)) == 0) {       // 1st, 2nd, 4th, ...
+                    std::cerr << "Spectator frame of " << frame.size() 
+                              << " bytes does not fit a ring slot (" << ringDrops << " dropped)" 
+                              << std::endl;
+                }
+            }
         }
     }
 
-    void updatePlayerScore(Player& player) {
-        if (!player.alive) return;
+    // Fire and forget: a lost snapshot is simply superseded by the next one.
+    void sendUdpState(Connection& c, const std::string& frame) {
+        std::string header = encodeUdpStateHeader(c.socket, ++c.stateSeq, c.inputSeq - 1);
+        struct iovec iov[2] = {{&header[0], header.size()},
+                               {const_cast<char*>(frame.data()), frame.size()}};
+        struct msghdr msg = {};
+        msg.msg_name = &c.peer;
+        msg.msg_namelen = sizeof(c.peer);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        sendmsg(udpSocket, &msg, MSG_NOSIGNAL);
+    }
 
-        time_t now = time(nullptr);
-        int timeDiff = static_cast<int>(now - player.lastScoreTime);
+    void sendUdpAccept(const Connection& c) {
+        SimPlayer* p = simFindPlayer(sim, c.socket);
+        if (!p) return;
+        std::string packet(1, static_cast<char>(UDP_ACCEPT));
+        putU32(packet, c.nonce);
+        putU32(packet, static_cast<uint32_t>(c.socket));
+        packet.push_back(static_cast<char>(c.codecs));
+        packet += std::to_string(p->playerIndex) + "," + std::to_string(p->colorIndex);
+        sendUdp(c, packet.data(), packet.size());
+    }
 
-        if (timeDiff > 0) {
-            int scoreIncrease = timeDiff * SCORE_SURVIVAL_TIME;
-            player.score += scoreIncrease;
-            player.lastScoreTime = now;
+    void sendUdp(const Connection& c, const char* data, size_t length) {
+        sendto(udpSocket, data, length, 0, reinterpret_cast<const sockaddr*>(&c.peer), sizeof(c.peer));
+    }
 
-            DEBUG_LOG("Player %d score increased by %d new score: %d", 
-                      player.playerIndex + 1, scoreIncrease, player.score);
+    void acceptUdp(uint32_t nonce, uint8_t offered, int64_t statsKey, const sockaddr_in& from) {
+        for (const auto& c : connections) {
+            if (c.udp && c.nonce == nonce && samePeer(c.peer, from)) {
+                sendUdpAccept(c);       // our ACCEPT was lost, CONNECT was retried
+                return;
+            }
+        }
+        if (sim.players.size() >= MAX_PLAYERS) {
+            evictBot();
+        }
+        SimPlayer* p = sim.players.size() < MAX_PLAYERS && !draining
+                     ? simAddPlayer(sim, nextUdpId, 0, 0, events) : nullptr;
+        events.clear();
+        invalidateHistory();
+        if (!p) {
+            std::string packet(1, static_cast<char>(UDP_REJECT));
+            putU32(packet, nonce);
+            sendto(udpSocket, packet.data(), packet.size(), 0,
+                   reinterpret_cast<const sockaddr*>(&from), sizeof(from));
+            return;
         }
+        uint64_t now = monotonicMs();
+        Connection c = {nextUdpId++,
+            timers.schedule(now + CONNECTION_TIMEOUT_MS, TIMER_IDLE, p->id),
+            timers.schedule(now + HEARTBEAT_INTERVAL_MS, TIMER_HEARTBEAT, p->id), 
+            static_cast<uint8_t>(offered & localCodecs())};
+        c.udp = true;
+        c.peer = from;
+        c.nonce = nonce;
+        c.inputSeq = 1;
+        c.lifeStart = sim.tick;
+        connections.push_back(c);
+        identifyLocked(connections.back(), statsKey);
+        sendUdpAccept(c);
+        std::cout << "Player " << p->playerIndex + 1 << " joined the game over UDP" << std::endl;
     }
 
-    bool checkCollision(int x, int y, const Player& player, Player** killer) {
-        if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) {
-            return true;
+    void touchLocked(Connection& conn) {
+        uint64_t now = monotonicMs();
+        conn.idleTimer = timers.reschedule(conn.idleTimer, now + CONNECTION_TIMEOUT_MS,
+                                           TIMER_IDLE, conn.socket);
+    }
+
+    void removePlayerLocked(int socket) {
+        SimPlayer* player = simFindPlayer(sim, socket);
+        if (!player) return;
+
+        DEBUG_LOG("Removing player - index:%d color:%d", 
+                 player->playerIndex, player->colorIndex);
+
+        if (stats::Record* r = statsOf(socket)) {
+            r->highScore = std::max(r->highScore, player->score);
+            if (player->alive) creditSurvival(*r, socket);
+            leaderboard.submit(statsKeyOf(socket), r->highScore);
+            leaderboard.flush();
         }
-        
-        if (board[y][x] != 0) {
-            int killerColorIndex = board[y][x] - 1;  
-            if (killerColorIndex == player.colorIndex) {
-                return false;  
-            }
-            for (auto& p : players) {
-                if (p.colorIndex == killerColorIndex) {
-                    *killer = &p;
-                    break;
+
+        auto conn = std::find_if(connections.begin(), connections.end(),
+            [socket](const Connection& c) { return c.socket == socket; });
+        if (conn != connections.end()) {
+            timers.cancel(conn->idleTimer);
+            timers.cancel(conn->heartbeatTimer);
+            connections.erase(conn);
+        }
+
+        simRemovePlayer(sim, socket, events);
+        invalidateHistory();
+        if (connections.empty()) {
+            while (evictBot()) {}
+        }
+        events.clear();
+        debugPrintState();
+        broadcastState();
+    }
+
+    // Turns simulation events into logs and high-score bookkeeping.
+    void processEvents() {
+        TRACE_SCOPE("events");
+        for (const auto& e : events) {
+            SimPlayer* player = simFindPlayer(sim, e.playerId);
+            if (!player) continue;
+            if (e.type == SIM_EVENT_DEATH) {
+                SimPlayer* killer = e.killerId != SIM_NO_PLAYER 
+                                  ? simFindPlayer(sim, e.killerId) : nullptr;
+                if (killer) {
+                    std::cout << "Player " << killer->playerIndex + 1 
+                             << " killed Player " << player->playerIndex + 1 
+                             << " [score:" << e.transfer << " = " 
+                             << sim.killPoints << " + " 
+                             << e.transfer - sim.killPoints 
+                             << "(" << (sim.transferRate * 100) << "% of " << e.score 
+                             << ")]" << std::endl;
+                } else {
+                    std::cout << "Player " << player->playerIndex + 1 
+                             << " died by crash with score " << e.score << std::endl;
                 }
+                if (stats::Record* r = killer ? statsOf(killer->id) : nullptr) r->kills++;
+                if (stats::Record* r = statsOf(player->id)) {
+                    r->deaths++;
+                    creditSurvival(*r, player->id);
+                    if (e.newHighScore) {
+                        r->highScore = e.score;
+                        leaderboard.submit(statsKeyOf(player->id), e.score);
+                    }
+                }
+            } else if (e.type == SIM_EVENT_RESPAWN) {
+                trace::instant("respawn");
+                if (Connection* conn = findConnection(player->id)) conn->lifeStart = sim.tick;
+                DEBUG_LOG("Player %d (color: %d) respawned at position (%d,%d)", 
+                          player->playerIndex + 1, player->colorIndex + 1, player->x, player->y);
             }
-            return true;
         }
-        return false;
+        events.clear();
     }
 
-    std::string serializeGameState() {	// DEBUG USE
-        std::string state;
-        state += "BEGIN\n";
-        state += "STATUS:" + std::to_string(gameRunning) + "\n";
-        state += "PLAYERS\n";
-        for (const auto& player : players) {
-            state += std::to_string(player.colorIndex) + ":" +  
-                     std::to_string(player.playerIndex) + "," +
-                     std::to_string(player.score) + "," +
-                     std::to_string(player.highScore) + "," +
-                     std::to_string(player.alive) + "," +
-                     std::to_string(player.x) + "," +
-                     std::to_string(player.y) + "," +
-                     std::to_string(player.dx) + "," +
-                     std::to_string(player.dy) + "\n";
+    void debugPrintState() {	// DEBUG USE
+        DEBUG_LOG("\nCurrent game state:");
+#if USE_BITBOARD
+        DEBUG_LOG("Occupied cells: %zu", sim.occupied.count());
+#endif
+        DEBUG_LOG("\nPlayers:");
+        for (const auto& p : sim.players) {
+            DEBUG_LOG("Player %d (color:%d, id:%d, score:%d%s)", 
+                      p.playerIndex, p.colorIndex, p.id, p.score, p.botLevel ? ", bot" : "");
         }
-        state += "BOARD\n";
-        for (const auto& row : board) {
-            for (int cell : row) {
-                state += std::to_string(cell) + ",";
-            }
-            state += "\n";
+        DEBUG_LOG("");
+    }
+
+    Connection* findConnection(int socket) {
+        for (auto& c : connections) {
+            if (c.socket == socket) return &c;
         }
-        state += "END\n";
-        return state;
+        return nullptr;
     }
 
-    void clearPlayerTrail(int colorIndex) {  
-        for (auto& row : board) {
-            for (auto& cell : row) {
-                if (cell == colorIndex + 1) {  
-                    cell = 0;
+    void onTimerExpired(int kind, int socket) {
+        Connection* conn = findConnection(socket);
+        if (!conn) return;
+
+        switch (kind) {
+            case TIMER_IDLE: {
+                conn->idleTimer = TimingWheel::INVALID_TIMER;
+                SimPlayer* player = simFindPlayer(sim, socket);
+                std::cout << "Player " << (player ? player->playerIndex + 1 : 0) 
+                          << " timeout" << std::endl;
+                if (conn->udp) {
+                    removePlayerLocked(socket);     // no connection thread to do it
+                } else {
+                    shutdown(socket, SHUT_RDWR);
+                }
+                break;
+            }
+            case TIMER_HEARTBEAT: {
+                // Every heartbeat is a ping; the echo measures the link.
+                if (conn->udp) {
+                    char packet[UDP_HEADER_SIZE + PING_PAYLOAD_SIZE];
+                    writeUdpHeader(packet, UDP_PING, static_cast<uint32_t>(socket));
+                    conn->ping.makePing(monotonicUs(), packet + UDP_HEADER_SIZE);
+                    sendUdp(*conn, packet, sizeof(packet));
+                } else {
+                    char frame[FRAME_HEADER_SIZE + PING_PAYLOAD_SIZE];
+                    writeFrameHeader(frame, MSG_HEARTBEAT, PING_PAYLOAD_SIZE);
+                    conn->ping.makePing(monotonicUs(), frame + FRAME_HEADER_SIZE);
+                    if (!sendLocked(*conn, frame, sizeof(frame))) {
+                        conn->heartbeatTimer = TimingWheel::INVALID_TIMER;
+                        break;
+                    }
+                }
+                conn->heartbeatTimer = timers.schedule(monotonicMs() + HEARTBEAT_INTERVAL_MS,
+                                                       TIMER_HEARTBEAT, socket);
+                if (conn->ping.sent() % PING_WINDOW == 0) {
+                    LinkStats link = conn->ping.stats(monotonicUs());
+                    SimPlayer* player = simFindPlayer(sim, socket);
+                    DEBUG_LOG("Player %d link: rtt %.1f ms (min %.1f) jitter %.1f ms loss %.0f%%",
+                              player ? player->playerIndex + 1 : 0, link.rttMs, link.minRttMs,
+                              link.jitterMs, link.lossPct);
                 }
+                break;
             }
         }
     }
 
-    void respawnPlayer(Player& player) {
-        try {
-            auto [x, y] = getRandomSafePosition();
-            auto [dx, dy] = getRandomDirection();
-            
-            clearPlayerTrail(player.colorIndex); 
-            player.x = x;
-            player.y = y;
-            player.dx = dx;
-            player.dy = dy;
-            player.alive = true;
-            player.score = 0;  
-            board[y][x] = player.colorIndex + 1;  
+    bool evictBot() {
+        auto it = std::find_if(sim.players.begin(), sim.players.end(),
+            [](const SimPlayer& p) { return p.botLevel != 0; });
+        if (it == sim.players.end()) return false;
+        DEBUG_LOG("Removing bot - index:%d color:%d", it->playerIndex, it->colorIndex);
+        simRemovePlayer(sim, it->id, events);
+        invalidateHistory();
+        return true;
+    }
 
-            DEBUG_LOG("Player %d (color: %d) respawned at position (%d,%d)", 
-                      player.playerIndex + 1, player.colorIndex + 1, x, y);
+    void fillWithBots() {
+        TRACE_SCOPE("fillBots");
+        if (!botsEnabled || connections.empty()) return;
 
-        } catch (const std::runtime_error& e) {
-            std::cerr << "Error respawning player " << player.playerIndex + 1 
-                      << ": " << e.what() << std::endl;
+        while (sim.players.size() < MAX_PLAYERS) {
+            SimPlayer* p = simAddPlayer(sim, nextBotId, 0, BOT_DEFAULT_LEVEL, events);
+            if (!p) return;
+            nextBotId--;
+            invalidateHistory();
+            std::cout << "Bot joined as player " << p->playerIndex + 1 << std::endl;
         }
     }
 
-    void handlePlayerDeath(Player& player, Player* killer, const std::string& cause) {
-        if (!player.alive) return;
-
-        updatePlayerScore(player);
-        int finalScore = player.score;
+    // Ticks before a join or leave cannot be replayed: the player list differs.
+    void invalidateHistory() {
+        historyStart = sim.tick;
+    }
 
-        if (finalScore > player.highScore) {
-            player.highScore = finalScore;
-            highScores[player.socket] = finalScore;
-            saveHighScores();
+    // Same path as an idle timeout: the connection thread cleans up TCP.
+    bool kickLocked(int socket) {
+        Connection* conn = findConnection(socket);
+        if (!conn) return false;
+        std::cout << "Admin kicked connection " << socket << std::endl;
+        if (conn->udp) {
+            removePlayerLocked(socket);
+        } else {
+            shutdown(socket, SHUT_RDWR);
         }
+        return true;
+    }
 
-        if (killer != nullptr && killer != &player && killer->alive) {
-            int scoreTransfer = SCORE_KILL_POINTS + 
-                              static_cast<int>(finalScore * SCORE_TRANSFER_RATE);
-            killer->score += scoreTransfer;
-            
-            std::cout << "Player " << killer->playerIndex + 1 
-                     << " killed Player " << player.playerIndex + 1 
-                     << " [score:" << scoreTransfer << " = " 
-                     << SCORE_KILL_POINTS << " + " 
-                     << static_cast<int>(finalScore * SCORE_TRANSFER_RATE) 
-                     << "(" << (SCORE_TRANSFER_RATE * 100) << "% of " << finalScore 
-                     << ")]" << std::endl;
+    void appendTunables(std::string& out) {
+        char text[320];
+        snprintf(text, sizeof(text),
+                 "tick_ms %d\nrespawn_delay_ms %d\nsurvival_points %d\nkill_points %d\n"
+                 "transfer_rate %g\nbot_budget_us %llu\nbots %d\nspectators %d\n",
+                 sim.tickMs, sim.respawnDelayMs, sim.survivalPoints, sim.killPoints,
+                 sim.transferRate, (unsigned long long)botBudgetUs, botsEnabled, 
+                 spectatorsEnabled);
+        out += text;
+    }
+
+    std::string setTunable(const std::string& name, const std::string& text) {
+        char* end;
+        double value = strtod(text.c_str(), &end);
+        if (end == text.c_str() || *end) return "not a number: " + text;
+        auto whole = [value](double lo, double hi) {
+            return value == static_cast<long long>(value) && value >= lo && value <= hi;
+        };
+        if (name == "tick_ms" && whole(1, 1000)) {
+            sim.tickMs = static_cast<int>(value);
+        } else if (name == "respawn_delay_ms" && whole(0, 600000)) {
+            sim.respawnDelayMs = static_cast<int>(value);
+        } else if (name == "survival_points" && whole(0, 1000000)) {
+            sim.survivalPoints = static_cast<int>(value);
+        } else if (name == "kill_points" && whole(0, 1000000)) {
+            sim.killPoints = static_cast<int>(value);
+        } else if (name == "transfer_rate" && value >= 0 && value <= 1) {
+            sim.transferRate = value;
+        } else if (name == "bot_budget_us" && whole(0, 1000000)) {
+            botBudgetUs = static_cast<uint64_t>(value);
+        } else if (name == "bots" && whole(0, 1)) {
+            botsEnabled = value != 0;
+            if (!botsEnabled) {
+                while (evictBot()) {}
+            }
+        } else if (name == "spectators" && whole(0, 1)) {
+            spectatorsEnabled = value != 0;
         } else {
-            std::cout << "Player " << player.playerIndex + 1 
-                     << " died by " << cause 
-                     << " with score " << finalScore << std::endl;
+            return "unknown tunable or out of range: " + name;
         }
+        // A lag-compensation rewind would restore the old values with the state.
+        invalidateHistory();
+        std::cout << "Admin set " << name << " = " << text << std::endl;
+        return "";
+    }
 
-        player.alive = false;
-        player.score = 0;
-        player.lastScoreTime = time(nullptr);
-        clearPlayerTrail(player.colorIndex);
+    // Widens a 32-bit tick stamp to the server's clock. Stamps from the future
+    // count as now.
+    uint64_t stampedTick(uint32_t seenTick) const {
+        uint32_t behind = static_cast<uint32_t>(sim.tick) - seenTick;
+        return behind > sim.tick || static_cast<int32_t>(behind) < 0 ? sim.tick : sim.tick - behind;
+    }
 
-        std::string state = serializeGameState();
-        for (const auto& p : players) {
-            send(p.socket, state.c_str(), state.length(), 0);
+    // Inputs for a tick already simulated wait for replayLateInputs(); the
+    // alive check is left to simStep, which knows who was alive back then.
+    void queueInputLocked(const SimPlayer& player, char input, uint64_t tick) {
+        if (tick < sim.tick) {
+            lateInputs.push_back({tick, {player.id, input}});
+        } else if (player.alive) {
+            pendingInputs.push_back({player.id, input});
         }
     }
 
-    int findAvailablePlayerIndex() {
-        std::vector<bool> used(MAX_PLAYERS, false);
-        for (const auto& player : players) {
-            if (player.playerIndex < MAX_PLAYERS) {
-                used[player.playerIndex] = true;
+    // Lag compensation: rewinds to the oldest tick a late input was meant for,
+    // adds the inputs to what that tick consumed and resimulates up to now.
+    // Inputs from beyond LAG_COMP_TICKS, or from before the last join or leave,
+    // are applied to the coming tick instead. Events the replay produces that
+    // the original run did not (a crash now avoided cannot be taken back) are
+    // handed to processEvents().
+    bool replayLateInputs() {
+        if (lateInputs.empty()) return false;
+        TRACE_SCOPE("lagReplay");
+        uint64_t now = sim.tick;
+        uint64_t oldest = std::max(historyStart, now > LAG_COMP_TICKS ? now - LAG_COMP_TICKS : 0);
+        uint64_t from = now;
+        for (const auto& late : lateInputs) {
+            if (late.tick < oldest) {
+                SimPlayer* p = simFindPlayer(sim, late.input.playerId);
+                if (p && p->alive) pendingInputs.push_back(late.input);
+                continue;
             }
+            history[late.tick % LAG_COMP_TICKS].inputs.push_back(late.input);
+            from = std::min(from, late.tick);
         }
-        for (int i = 0; i < MAX_PLAYERS; i++) {
-            if (!used[i]) return i;
-        }
-        return -1;
-    }
+        lateInputs.clear();
+        if (from == now) return false;
 
-    void occupyColorIndex(int colorIndex) {
-        if (colorIndex >= 0 && colorIndex < MAX_PLAYERS) {
-            usedColorIndices[colorIndex] = true;
+        sim = history[from % LAG_COMP_TICKS].before;
+        for (uint64_t t = from; t < now; t++) {
+            TickRecord& rec = history[t % LAG_COMP_TICKS];
+            if (t != from) rec.before = sim;
+            replayEvents.clear();
+            simStep<Rules>(sim, rec.inputs.data(), rec.inputs.size(), replayEvents);
+            for (const auto& e : replayEvents) {
+                bool seen = std::any_of(rec.events.begin(), rec.events.end(),
+                    [&e](const SimEvent& o) { return o.type == e.type && o.playerId == e.playerId; });
+                if (!seen) events.push_back(e);
+            }
+            rec.events.swap(replayEvents);
         }
+        rewinds++;
+        DEBUG_LOG("Rewound %llu ticks for late input (%llu rewinds)",
+                  (unsigned long long)(now - from), (unsigned long long)rewinds);
+        return true;
     }
 
-    void debugPrintState() {	// DEBUG USE
-        DEBUG_LOG("\nCurrent game state:");
-        DEBUG_LOG("Used color indices: ");
-        for (int i = 0; i < MAX_PLAYERS; i++) {
-            DEBUG_LOG("%d:%d ", i, usedColorIndices[i] ? 1 : 0);
+    // Commits up to JOIN_ADMITS_PER_TICK queued joins at the tick boundary
+    // under the lock the tick already holds; the rest wait for later ticks,
+    // so a burst spreads over several ticks instead of stalling one. Joiners
+    // are not written to here: their index and first state are queued and
+    // their connection thread sends them, outside the lock.
+    bool admitJoinsLocked() {
+        {
+            std::lock_guard<std::mutex> lock(joinMutex);
+            if (joinQueue.empty()) return false;
+            size_t take = std::min<size_t>(joinQueue.size(), JOIN_ADMITS_PER_TICK);
+            admitting.assign(joinQueue.begin(), joinQueue.begin() + take);
+            joinQueue.erase(joinQueue.begin(), joinQueue.begin() + take);
         }
-        DEBUG_LOG("\nPlayers:");
-        for (const auto& p : players) {
-            DEBUG_LOG("Player %d (color:%d, socket:%d, score:%d)", 
-                      p.playerIndex, p.colorIndex, p.socket, p.score);
+        TRACE_SCOPE("admit");
+        uint64_t now = monotonicMs();
+        for (int socket : admitting) {
+            if (sim.players.size() >= MAX_PLAYERS) {
+                evictBot();
+            }
+            SimPlayer* p = simAddPlayer(sim, socket, 0, 0, events);
+            if (!p) {
+                DEBUG_LOG("No available slots for socket %d", socket);
+                turnedAway.push_back(socket);
+                continue;
+            }
+            connections.push_back({socket,
+                timers.schedule(now + CONNECTION_TIMEOUT_MS, TIMER_IDLE, socket),
+                timers.schedule(now + HEARTBEAT_INTERVAL_MS, TIMER_HEARTBEAT, socket), 0});
+            connections.back().lifeStart = sim.tick;
+            connections.back().starting = true;
+
+            DEBUG_LOG("Adding new player - socket:%d playerIndex:%d colorIndex:%d", 
+                     socket, p->playerIndex, p->colorIndex);
+
+            char index[FRAME_HEADER_SIZE + 24];
+            int length = snprintf(index + FRAME_HEADER_SIZE, sizeof(index) - FRAME_HEADER_SIZE,
+                                  "%d,%d", p->playerIndex, p->colorIndex);
+            writeFrameHeader(index, MSG_INDEX, length);
+            sendLocked(connections.back(), index, FRAME_HEADER_SIZE + length);
+            admitted.push_back(socket);
+            std::cout << "Player " << p->playerIndex + 1 << " joined the game" << std::endl;
         }
-        DEBUG_LOG("");
+        admitting.clear();
+        events.clear();
+        invalidateHistory();
+        debugPrintState();
+        return true;
     }
 
-    void initializeNewPlayer(Player& p) {
-        PlayerScore score = {0, 0, p.colorIndex};
-        if (playerScores.find(p.socket) != playerScores.end()) {
-            score.high = playerScores[p.socket].high;
-        }
-        playerScores[p.socket] = score;
+    // Bots steer through the same input queue as humans. Once a tick has
+    // spent BOT_TICK_BUDGET_US, remaining bots drop to the cheapest level.
+    void runBots() {
+        TRACE_SCOPE("bots");
+        uint64_t spentUs = bots.decide(sim, pendingInputs, botBudgetUs);
+        const auto& stats = bots.getStats();
+        if (!stats.ticks) return;
+        DEBUG_LOG("Bots: %llu us this tick, avg %llu us, max %llu us, degraded %llu", 
+                  (unsigned long long)spentUs,
+                  (unsigned long long)(stats.totalUs / stats.ticks),
+                  (unsigned long long)stats.maxTickUs,
+                  (unsigned long long)stats.degraded);
     }
 
 public:
-    TronGame() {
-        board = std::vector<std::vector<int>>(BOARD_HEIGHT, 
-                std::vector<int>(BOARD_WIDTH, 0));
+    TronGame(Leaderboard& board, const std::string& modeName) 
+        : mode(modeName), leaderboard(board), timers(TIMER_WHEEL_TICK_MS, monotonicMs()) {
+        std::random_device rd;
+        simInit(sim, (uint64_t(rd()) << 32) | rd());
         gameRunning = true;
-        loadHighScores();
-        usedColorIndices = std::vector<bool>(MAX_PLAYERS, false);
     }
 
-    void addPlayer(int socket) {
-        std::lock_guard<std::mutex> lock(gameMutex);
-        if (players.size() < MAX_PLAYERS) {
-            try {
-                auto [x, y] = getRandomSafePosition();
-                auto [dx, dy] = getRandomDirection();
-                int colorIndex = -1;
-                for (int i = 0; i < MAX_PLAYERS; i++) {
-                    if (!usedColorIndices[i]) {
-                        colorIndex = i;
-                        break;
-                    }
-                }
-                int playerIndex = findAvailablePlayerIndex();
-                if (playerIndex < 0 || colorIndex < 0) {
-                    std::cerr << "No available slots" << std::endl;
-                    close(socket);
-                    return;
-                }
-                usedColorIndices[colorIndex] = true;
-                Player p = {x, y, dx, dy, true, socket, playerIndex,
-                          0, socketToHighScores[socket], time(nullptr)};
-                p.colorIndex = colorIndex;
-
-                DEBUG_LOG("Adding new player - socket:%d playerIndex:%d colorIndex:%d", 
-                         socket, playerIndex, colorIndex);
-
-                std::string indexMsg = "INDEX:" + std::to_string(playerIndex) + 
-                                     "," + std::to_string(colorIndex) + "\n";
-                send(socket, indexMsg.c_str(), indexMsg.length(), 0);
-
-                players.push_back(p);
-                board[y][x] = colorIndex + 1;
-                initializeNewPlayer(p);  
-                debugPrintState();
-
-                std::string state = serializeGameState();
-                if (send(socket, state.c_str(), state.length(), 0) <= 0) {
-                    std::cerr << "Failed to send initial state to player" << std::endl;
-                    close(socket);
-                    return;
-                }
-                std::cout << "Player " << playerIndex + 1 << " joined the game" << std::endl;
-            } catch (const std::runtime_error& e) {
-                DEBUG_LOG("Failed to add new player: %s", e.what());
-                close(socket);
-            }
+    // Ring frames are uncompressed RLE text: a board cell takes at most its
+    // value's digits and a comma, plus a newline per row, after a header and
+    // player lines of bounded length.
+    uint32_t ringSlotSize() const {
+        size_t cellBytes = 2;
+        for (int v = MAX_PLAYERS; v >= 10; v /= 10) cellBytes++;
+        size_t frame = FRAME_HEADER_SIZE + 256 + MAX_PLAYERS * 128 +
+                       static_cast<size_t>(sim.height) * (cellBytes * sim.width + 1);
+        return static_cast<uint32_t>(std::max<size_t>(SHM_RING_SLOT_SIZE, frame));
+    }
+
+    // Worker rooms after the first keep their own stats file and frame ring.
+    // On a takeover both still belong to the running server until importState()
+    // succeeds; the ring is then adopted in place so spectators keep reading.
+    void openOutputs(int worker, int workers, bool takeover) {
+        rankScope = workers > 0 ? worker + 1 : 0;
+        openStats(worker);
+        if (!SHM_RING_ENABLED) return;
+        std::string ring = workers::workerPath(SHM_RING_NAME, worker);
+        uint32_t slotSize = ringSlotSize();
+        if (takeover && frameRing.adopt(ring.c_str(), SHM_RING_SLOTS, slotSize)) return;
+        if (!frameRing.create(ring.c_str(), SHM_RING_SLOTS, slotSize)) {
+            std::cerr << "Shared memory ring unavailable: " << strerror(errno) << std::endl;
         }
     }
 
-    void handleInput(int colorIndex, char input) {  
-        std::lock_guard<std::mutex> lock(gameMutex);
-        
-        auto it = std::find_if(players.begin(), players.end(),
-            [colorIndex](const Player& p) { return p.colorIndex == colorIndex; });
-        if (it == players.end() || !it->alive) return;
-        Player& player = *it;
-        
-        DEBUG_LOG("Received input from player %d (color:%d): %c", 
-                  player.playerIndex + 1, player.colorIndex, input);
-        
-        int newDx = player.dx;
-        int newDy = player.dy;
-        switch(input) {
-            case KEY_UP:    if (player.dy != 1)  { newDx = 0; newDy = -1; } break;
-            case KEY_DOWN:  if (player.dy != -1) { newDx = 0; newDy = 1; }  break;
-            case KEY_LEFT:  if (player.dx != 1)  { newDx = -1; newDy = 0; } break;
-            case KEY_RIGHT: if (player.dx != -1) { newDx = 1; newDy = 0; }  break;
+    // Accepted connections wait here for the next tick; the accept loop never
+    // takes the room lock. A draining room turns them away.
+    void queueJoin(int socket) {
+        if (draining) {
+            close(socket);
+            return;
         }
-        
-        if (newDx != player.dx || newDy != player.dy) {
-            player.dx = newDx;
-            player.dy = newDy;
+        std::lock_guard<std::mutex> lock(joinMutex);
+        joinQueue.push_back(socket);
+    }
 
-            DEBUG_LOG("Player %d direction changed to: (%d,%d)", 
-                      player.playerIndex + 1, player.dx, player.dy);
+    // Sockets admitted by the last tick, for the caller to start threads on.
+    // Joins that found the room full are closed here, off the tick.
+    void takeAdmitted(std::vector<int>& out) {
+        std::vector<int> rejected;
+        {
+            std::lock_guard<std::mutex> lock(gameMutex);
+            out.swap(admitted);
+            admitted.clear();
+            rejected.swap(turnedAway);
+        }
+        if (!rejected.empty()) {
+            std::cerr << "No available slots for " << rejected.size() << " joins" << std::endl;
         }
+        for (int socket : rejected) close(socket);
     }
-	
-    int getPlayerSocket(int playerIndex) {
+
+    // Called by the connection thread whenever bytes arrive from the client.
+    void touchConnection(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (conn) touchLocked(*conn);
+    }
+
+    // Echoed under the room lock so it cannot land inside a state frame.
+    void echoHeartbeat(int socket, const char* payload, size_t length) {
+        if (length != PING_PAYLOAD_SIZE) return;
+        char frame[FRAME_HEADER_SIZE + PING_PAYLOAD_SIZE];
+        writeFrameHeader(frame, MSG_HEARTBEAT_ACK, PING_PAYLOAD_SIZE);
+        memcpy(frame + FRAME_HEADER_SIZE, payload, PING_PAYLOAD_SIZE);
         std::lock_guard<std::mutex> lock(gameMutex);
-        if (playerIndex >= 0 && playerIndex < players.size()) {
-            return players[playerIndex].socket;
+        Connection* conn = findConnection(socket);
+        if (conn) sendLocked(*conn, frame, sizeof(frame));
+    }
+
+    // Whether the connection thread should wait for the socket to drain.
+    bool hasOutput(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        return conn && !conn->outbox.empty();
+    }
+
+    // Also ends a new connection's start: from here the tick writes to it.
+    void flushOutput(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (!conn) return;
+        conn->starting = false;
+        flushLocked(*conn);
+    }
+
+    void heartbeatAcked(int socket, const char* payload, size_t length) {
+        uint64_t now = monotonicUs();
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (conn) conn->ping.onAck(payload, length, now);
+    }
+
+    // Hot restart (see handoff.h). Once handing off, connection threads stop
+    // reading and leave their unparsed bytes with the connection.
+    void beginHandoff() { handingOff = true; }
+    void endHandoff() { handingOff = false; }
+    bool isHandingOff() const { return handingOff; }
+
+    void stashUnread(int socket, std::string bytes) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (conn) conn->unread = std::move(bytes);
+    }
+
+    std::string takeUnread(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        std::string bytes;
+        if (conn) bytes.swap(conn->unread);
+        return bytes;
+    }
+
+    std::vector<int> tcpSockets() {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        std::vector<int> sockets;
+        for (const auto& c : connections) {
+            if (!c.udp) sockets.push_back(c.socket);
         }
-        return -1;
+        return sockets;
     }
 
-    size_t getPlayerCount() const {
-        return players.size();
+    // Appends the room to out; tcpFds receives the client sockets in the
+    // order importState() expects them.
+    void exportState(std::string& out, std::vector<int>& tcpFds) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        playerStats.settle();           // the next process maps the file at STATS_FILE
+        putU32(out, handoff::MAGIC);
+        handoff::putString(out, mode);
+        handoff::encodeSim(sim, out);
+        out.push_back(static_cast<char>(gameRunning));
+        handoff::putI32(out, nextBotId);
+        handoff::putI32(out, nextUdpId);
+        putU32(out, static_cast<uint32_t>(connections.size()));
+        for (const auto& c : connections) {
+            handoff::putI32(out, c.socket);
+            out.push_back(static_cast<char>(c.udp));
+            putU32(out, c.udp ? c.peer.sin_addr.s_addr : 0);
+            putU32(out, c.udp ? c.peer.sin_port : 0);
+            putU32(out, c.nonce);
+            putU32(out, c.stateSeq);
+            putU32(out, c.inputSeq);
+            handoff::putI32(out, c.viewW);
+            handoff::putI32(out, c.viewH);
+            out.push_back(static_cast<char>(c.codecs));
+            handoff::putU64(out, static_cast<uint64_t>(c.statsKey));
+            putU32(out, static_cast<uint32_t>(c.unread.size()));
+            out += c.unread;
+            putU32(out, static_cast<uint32_t>(c.outbox.size()));
+            out += c.outbox;
+            if (!c.udp) tcpFds.push_back(c.socket);
+        }
     }
 
-    void removePlayer(int playerIndex) {
+    // Loads a room exported by the previous process. Its TCP players were
+    // keyed by its fd numbers; they are renamed to the fds received here.
+    void importState(const char* data, size_t length, const std::vector<int>& tcpFds) {
         std::lock_guard<std::mutex> lock(gameMutex);
-        auto it = std::find_if(players.begin(), players.end(),
-            [playerIndex](const Player& p) { return p.playerIndex == playerIndex; });
-        
-        if (it != players.end()) {
-            DEBUG_LOG("Removing player - index:%d color:%d", 
-                     playerIndex, it->colorIndex);
+        handoff::Reader in(data, length);
+        if (in.u32() != handoff::MAGIC) throw std::runtime_error("not a handoff snapshot");
+        std::string snapshotMode = handoff::getString(in);
+        if (snapshotMode != mode) {
+            throw std::runtime_error("room plays " + snapshotMode + ", this server " + mode);
+        }
+        SimState loaded;
+        handoff::decodeSim(in, loaded);
+        bool running = in.u8() != 0;
+        int botId = in.i32();
+        int udpId = in.i32();
+        uint32_t count = in.u32();
+        std::vector<Connection> loadedConnections;
+        std::map<int, int> renamed;
+        uint64_t now = monotonicMs();
+        for (uint32_t i = 0; i < count; i++) {
+            Connection c = {};
+            int oldSocket = in.i32();
+            c.udp = in.u8() != 0;
+            c.peer.sin_family = AF_INET;
+            c.peer.sin_addr.s_addr = in.u32();
+            c.peer.sin_port = static_cast<in_port_t>(in.u32());
+            c.nonce = in.u32();
+            c.stateSeq = in.u32();
+            c.inputSeq = in.u32();
+            c.viewW = in.i32();
+            c.viewH = in.i32();
+            c.codecs = in.u8() & localCodecs();
+            c.statsKey = static_cast<int64_t>(in.u64());
+            uint32_t unreadLength = in.u32();
+            c.unread.assign(in.take(unreadLength), unreadLength);
+            uint32_t outboxLength = in.u32();
+            c.outbox.assign(in.take(outboxLength), outboxLength);
+            c.socket = oldSocket;
+            if (!c.udp) {
+                if (renamed.size() >= tcpFds.size()) throw std::runtime_error("missing client fd");
+                c.socket = tcpFds[renamed.size()];
+                renamed[oldSocket] = c.socket;
+            }
+            loadedConnections.push_back(std::move(c));
+        }
+        for (auto& p : loaded.players) {
+            auto it = renamed.find(p.id);
+            if (it != renamed.end()) p.id = it->second;
+        }
 
-            usedColorIndices[it->colorIndex] = false;
-            
-            socketToHighScores[it->socket] = std::max(
-                socketToHighScores[it->socket], 
-                it->score
-            );
-            saveHighScores();
-            clearPlayerTrail(it->colorIndex);
-            players.erase(it);
-            debugPrintState();
-
-            std::string state = serializeGameState();
-            std::vector<int> failedPlayers;
-            for (const auto& p : players) {
-                if (send(p.socket, state.c_str(), state.length(), 0) < 0) {
-                    failedPlayers.push_back(p.playerIndex);
+        sim = std::move(loaded);
+        gameRunning = running;
+        nextBotId = botId;
+        nextUdpId = udpId;
+        connections = std::move(loadedConnections);
+        for (auto& c : connections) {
+            c.idleTimer = timers.schedule(now + CONNECTION_TIMEOUT_MS, TIMER_IDLE, c.socket);
+            c.heartbeatTimer = timers.schedule(now + HEARTBEAT_INTERVAL_MS, TIMER_HEARTBEAT, c.socket);
+            c.lifeStart = sim.tick;
+            SimPlayer* p = c.statsKey ? simFindPlayer(sim, c.socket) : nullptr;
+            if (p && p->highScore > 0) leaderboard.submit(c.statsKey, p->highScore);
+        }
+        pendingInputs.clear();
+        lateInputs.clear();
+        invalidateHistory();
+        leaderboard.flush();
+    }
+
+    // Admin commands (admin.h) other than the process-level ones. Returns the
+    // reason for an ERR reply, or an empty string.
+    std::string adminCommand(const std::vector<std::string>& words, std::string& out) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        const std::string& command = words[0];
+        if (command == "room") {
+            int bots = 0;
+            for (const auto& p : sim.players) bots += p.botLevel != 0;
+            char text[160];
+            snprintf(text, sizeof(text), 
+                     "tick=%llu tick_ms=%d players=%zu bots=%d ranked=%zu ring_drops=%llu %s\n",
+                     (unsigned long long)sim.tick, sim.tickMs, sim.players.size() - bots, bots,
+                     leaderboard.size(), (unsigned long long)ringDrops, 
+                     draining ? "draining" : "open");
+            out += text;
+        } else if (command == "players") {
+            uint64_t nowUs = monotonicUs();
+            for (const auto& p : sim.players) {
+                const Connection* c = findConnection(p.id);
+                char text[160];
+                int length = snprintf(text, sizeof(text), 
+                    "id=%d player=%d color=%d %s score=%d high=%d %s",
+                    p.id, p.playerIndex + 1, p.colorIndex + 1, p.alive ? "alive" : "dead", 
+                    p.score, p.highScore, p.botLevel ? "bot" : c && c->udp ? "udp" : "tcp");
+                if (c) {
+                    LinkStats link = c->ping.stats(nowUs);
+                    snprintf(text + length, sizeof(text) - length, " rtt=%.1fms loss=%.0f%%",
+                             link.rttMs, link.lossPct);
                 }
+                out += text;
+                out += '\n';
             }
-            for (int index : failedPlayers) {
-                removePlayer(index);
-            }
+        } else if (command == "snapshot") {
+            serializeGameState(out);
+        } else if (command == "kick" && words.size() == 2) {
+            if (!kickLocked(atoi(words[1].c_str()))) return "no connection " + words[1];
+        } else if (command == "drain" || command == "open") {
+            draining = command == "drain";
+            std::cout << "Admin " << (draining ? "drained" : "opened") << " the room" << std::endl;
+        } else if (command == "close") {
+            draining = true;
+            std::vector<int> sockets;
+            for (const auto& c : connections) sockets.push_back(c.socket);
+            for (int socket : sockets) kickLocked(socket);
+            out += "kicked " + std::to_string(sockets.size()) + "\n";
+        } else if (command == "get" && words.size() == 1) {
+            appendTunables(out);
+        } else if (command == "set" && words.size() == 3) {
+            return setTunable(words[1], words[2]);
+        } else {
+            return "unknown command, try help";
         }
+        return "";
     }
 
-    void updateGame() {
-        if (!gameRunning) return;
+    int tickInterval() {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        return sim.tickMs;
+    }
+
+    uint64_t currentTick() {
         std::lock_guard<std::mutex> lock(gameMutex);
+        return sim.tick;
+    }
 
-        std::vector<int> disconnectedPlayers;
-        for (const auto& player : players) {
-            int testSend = send(player.socket, "", 0, MSG_NOSIGNAL);
-            if (testSend < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                disconnectedPlayers.push_back(player.playerIndex);
+    void setUdpSocket(int fd) {
+        udpSocket = fd;
+    }
+
+    // Called by the UDP thread for every datagram on the game port.
+    void handleDatagram(const char* data, size_t length, const sockaddr_in& from) {
+        TRACE_SCOPE("datagram");
+        if (length < 5 || handingOff) return;
+        std::lock_guard<std::mutex> lock(gameMutex);
+        uint8_t kind = static_cast<uint8_t>(data[0]);
+        uint32_t id = getU32(data + 1);
+        if (kind == UDP_CONNECT) {
+            if (length >= 6) {
+                acceptUdp(id, static_cast<uint8_t>(data[5]), nameKey(data + 6, length - 6), from);
             }
+            return;
         }
-        for (int index : disconnectedPlayers) {
-            removePlayer(index);
+
+        Connection* conn = findConnection(static_cast<int>(id));
+        if (!conn || !conn->udp || !samePeer(conn->peer, from)) return;
+        touchLocked(*conn);
+        if (kind == UDP_INPUT && length >= 10) {
+            uint32_t first = getU32(data + 5);
+            size_t count = std::min<size_t>(static_cast<uint8_t>(data[9]), (length - 10) / 5);
+            SimPlayer* player = simFindPlayer(sim, conn->socket);
+            for (size_t i = 0; i < count; i++) {
+                uint32_t seq = first + static_cast<uint32_t>(i);
+                if (seqNewer(conn->inputSeq, seq)) continue;    // resent, already applied
+                conn->inputSeq = seq + 1;
+                const char* entry = data + 10 + 5 * i;
+                if (player) queueInputLocked(*player, entry[0], stampedTick(getU32(entry + 1)));
+            }
+        } else if (kind == UDP_PING && length == UDP_HEADER_SIZE + PING_PAYLOAD_SIZE) {
+            char reply[UDP_HEADER_SIZE + PING_PAYLOAD_SIZE];
+            memcpy(reply, data, sizeof(reply));
+            reply[0] = static_cast<char>(UDP_PONG);
+            sendUdp(*conn, reply, sizeof(reply));
+        } else if (kind == UDP_PONG) {
+            conn->ping.onAck(data + UDP_HEADER_SIZE, length - UDP_HEADER_SIZE, monotonicUs());
+        } else if (kind == UDP_DISCONNECT) {
+            removePlayerLocked(conn->socket);
         }
+    }
 
-        static std::map<int, time_t> deathTimes;
-        bool stateChanged = false;
+    // Keeps the codecs both sides support and echoes the result back; a
+    // player name after the codec mask picks the stats record.
+    void acceptHello(int socket, const char* data, size_t length) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (!conn) return;
+        conn->codecs = static_cast<uint8_t>(data[0]) & localCodecs();
+        identifyLocked(*conn, nameKey(data + 1, length - 1));
+        char reply[FRAME_HEADER_SIZE + 1];
+        writeFrameHeader(reply, MSG_HELLO, 1);
+        reply[FRAME_HEADER_SIZE] = static_cast<char>(conn->codecs);
+        sendLocked(*conn, reply, sizeof(reply));
+        encodeStateFrame(windowedFrame, conn->codecs);
+        size_t packedSize = windowedFrame.size();
+        encodeStateFrame(windowedFrame, 0);
+        DEBUG_LOG("Socket %d codecs:%d state frame %zu bytes (plain %zu)", socket, conn->codecs,
+                  packedSize, windowedFrame.size());
+    }
 
-        for (auto& player : players) {
-            if (player.alive) {
-                updatePlayerScore(player);
-            }
+    // A viewport that, with its margin, covers the board gets full frames.
+    void setViewport(int socket, int cols, int rows) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        Connection* conn = findConnection(socket);
+        if (!conn) return;
+        cols = std::max(cols, VIEWPORT_MIN_COLS);
+        rows = std::max(rows, VIEWPORT_MIN_ROWS);
+        bool covers = cols + 2 * VIEWPORT_MARGIN >= sim.width && 
+                      rows + 2 * VIEWPORT_MARGIN >= sim.height;
+        conn->viewW = covers ? 0 : cols;
+        conn->viewH = covers ? 0 : rows;
+        DEBUG_LOG("Socket %d viewport %dx%d%s", socket, cols, rows, covers ? " (full board)" : "");
+    }
+
+    // Unstamped input (MSG_INPUT) applies to the coming tick; stamped input
+    // (MSG_INPUT_AT) to the tick after the state the player saw.
+    void handleInput(int colorIndex, const char* keys, size_t count, 
+                     bool stamped = false, uint32_t seenTick = 0) {  
+        std::lock_guard<std::mutex> lock(gameMutex);
+        
+        auto it = std::find_if(sim.players.begin(), sim.players.end(),
+            [colorIndex](const SimPlayer& p) { return p.colorIndex == colorIndex; });
+        if (it == sim.players.end()) return;
+        
+        uint64_t tick = stamped ? stampedTick(seenTick) : sim.tick;
+        for (size_t i = 0; i < count; i++) {
+            DEBUG_LOG("Received input from player %d (color:%d): %c at tick %llu", 
+                      it->playerIndex + 1, it->colorIndex, keys[i], (unsigned long long)tick);
+            queueInputLocked(*it, keys[i], tick);
         }
+    }
+	
+    void removePlayer(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        removePlayerLocked(socket);
+    }
 
-        for (auto& player : players) {
-            if (player.alive) {
-                int newX = player.x + player.dx;
-                int newY = player.y + player.dy;
+    void updateGame() {
+        if (!gameRunning) return;
+        TRACE_SCOPE("tick");
+        std::lock_guard<std::mutex> lock(gameMutex);
+        uint64_t allocMark = allocCount();
 
-                DEBUG_LOG("Moving player %d from (%d,%d) to (%d,%d)", 
-                          player.playerIndex + 1, player.x, player.y, newX, newY);
+        {
+            TRACE_SCOPE("liveness");
+            timers.advance(monotonicMs(), [this](int kind, int socket) {
+                onTimerExpired(kind, socket);
+            });
+        }
+        bool joined = admitJoinsLocked();
+        fillWithBots();
+        bool rewound = replayLateInputs();
+        runBots();
 
-                Player* killer = nullptr;
-                bool willCollide = checkCollision(newX, newY, player, &killer);
-                board[player.y][player.x] = player.colorIndex + 1;
-                if (willCollide) {
-                    handlePlayerDeath(player, killer, killer ? "be killde" : "crash");
-                    stateChanged = true;
-                    continue;
-                }
-                player.x = newX;
-                player.y = newY;
-                board[player.y][player.x] = player.colorIndex + 1;
-                stateChanged = true;
-            } else {
-                time_t now = time(nullptr);
-                auto it = deathTimes.find(player.playerIndex);
-                if (it == deathTimes.end()) {
-                    deathTimes[player.playerIndex] = now;
-                } else if (now - it->second >= RESPAWN_DELAY) {
-                    respawnPlayer(player);
-                    deathTimes.erase(it);
-                    stateChanged = true;
-                }
-            }
+        TickRecord& rec = history[sim.tick % LAG_COMP_TICKS];
+        bool stateChanged;
+        {
+            TRACE_SCOPE("simStep");
+            rec.before = sim;
+            rec.inputs = pendingInputs;
+            size_t firstEvent = events.size();
+            stateChanged = simStep<Rules>(sim, pendingInputs.data(), pendingInputs.size(), 
+                                          events);
+            rec.events.assign(events.begin() + firstEvent, events.end());
+            pendingInputs.clear();
+        }
+        stateChanged = stateChanged || rewound || joined;
+        processEvents();
+        seedLeaderboard();
+        {
+            TRACE_SCOPE("leaderboard");
+            leaderboard.flush();
+        }
+        playerStats.migrate(STATS_MIGRATE_PER_TICK);
+        uint64_t nowMs = monotonicMs();
+        if (nowMs >= nextStatsSync) {
+            playerStats.sync();
+            nextStatsSync = nowMs + STATS_SYNC_MS;
         }
 
         if (stateChanged) {
             DEBUG_LOG("Game state updated. Active players: ");
-            for (const auto& player : players) {
+            for (const auto& player : sim.players) {
                 DEBUG_LOG("Player %d(%s at %d,%d moving %d,%d) ", 
                           player.playerIndex + 1, player.alive ? "alive" : "dead", 
                           player.x, player.y, player.dx, player.dy);
             }
             DEBUG_LOG("");
 
-            std::string state = serializeGameState();
-            std::vector<int> failedPlayers;
-            for (const auto& player : players) {
-                if (send(player.socket, state.c_str(), state.length(), 0) < 0) {
-                    failedPlayers.push_back(player.playerIndex); 
-                }
-            }
-            
-            for (int index : failedPlayers) {
-                removePlayer(index);
-            }
+            broadcastState();
+        }
+
+        // A steady-state tick should not touch the heap; buffers only grow
+        // while frames get bigger or players join.
+        uint64_t allocated = allocCount() - allocMark;
+        tickAllocs.record(allocated);
+        if (allocated) {
+            DEBUG_LOG("Tick %llu made %llu heap allocations (%llu of %llu ticks allocated)",
+                      (unsigned long long)sim.tick, (unsigned long long)allocated,
+                      (unsigned long long)tickAllocs.allocatingTicks,
+                      (unsigned long long)tickAllocs.ticks);
         }
     }
 
     int getColorIndexBySocket(int socket) {
         std::lock_guard<std::mutex> lock(gameMutex);
-        for (const auto& player : players) {
-            if (player.socket == socket) {
-                return player.colorIndex;
-            }
-        }
-        return -1;
+        SimPlayer* player = simFindPlayer(sim, socket);
+        return player ? player->colorIndex : -1;
+    }
+
+    int getPlayerIndexBySocket(int socket) {
+        std::lock_guard<std::mutex> lock(gameMutex);
+        SimPlayer* player = simFindPlayer(sim, socket);
+        return player ? player->playerIndex : -1;
     }
 };
 
-void handleClient(TronGame& game, int playerIndex) {
-    char buffer[BUFFER_SIZE];
-    int playerSocket = game.getPlayerSocket(playerIndex);
+template <class Game>
+void handleClient(Game& game, int playerSocket) {
+    trace::nameThread("client");
+    FrameParser parser(BUFFER_SIZE);
+    int playerIndex = game.getPlayerIndexBySocket(playerSocket);
     int colorIndex = game.getColorIndexBySocket(playerSocket);  
-    time_t lastHeartbeat = time(nullptr);
     bool connectionAlive = true;
     
     #ifdef __APPLE__
@@ -535,105 +1302,494 @@ void handleClient(TronGame& game, int playerIndex) {
         close(playerSocket);
         return;
     }
+    std::string unread = game.takeUnread(playerSocket);     // left by a parked thread
+    parser.append(unread.data(), unread.size());
+    game.flushOutput(playerSocket);     // index and first state, queued at admission
 
-    while (connectionAlive) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(playerSocket, &readfds);
-        
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000; 
-        
-        int selectResult = select(playerSocket + 1, &readfds, NULL, NULL, &tv);
-        if (selectResult < 0) {
-            std::cerr << "Select error for player " << playerIndex << std::endl;
-            break;
+    while (connectionAlive && !game.isHandingOff()) {
+        short events = POLLIN | (game.hasOutput(playerSocket) ? POLLOUT : 0);
+        struct pollfd pfd = {playerSocket, events, 0};
+        int pollResult = poll(&pfd, 1, 100);
+        if (pollResult > 0 && (pfd.revents & POLLOUT)) {
+            game.flushOutput(playerSocket);
         }
-        
-        time_t now = time(nullptr);
-        if (now - lastHeartbeat > SOCKET_TIMEOUT) {
-            std::cout << "Player " << playerIndex + 1 << " timeout" << std::endl;
+        if (pollResult < 0 && errno != EINTR) {
+            std::cerr << "Poll error for player " << playerIndex << std::endl;
+            connectionAlive = false;
             break;
         }
         
-        if (selectResult > 0 && FD_ISSET(playerSocket, &readfds)) {
-            int bytesRead = recv(playerSocket, buffer, sizeof(buffer), 0);
+        if (pollResult > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t bytesRead = parser.readFrom(playerSocket);
             if (bytesRead <= 0) {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                if (bytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
                     connectionAlive = false;
                 }
                 continue;
             }
             
-            lastHeartbeat = now;
-            if (buffer[0] == 'h') {
-                DEBUG_LOG("Heartbeat received from player %d", playerIndex + 1);
-                continue;
+            TRACE_SCOPE("frames");
+            game.touchConnection(playerSocket);
+            MessageType type;
+            const char* data;
+            size_t length;
+            try {
+                while (parser.next(type, data, length)) {
+                    if (type == MSG_HEARTBEAT) {
+                        DEBUG_LOG("Heartbeat received from player %d", playerIndex + 1);
+                        game.echoHeartbeat(playerSocket, data, length);
+                    } else if (type == MSG_HEARTBEAT_ACK) {
+                        game.heartbeatAcked(playerSocket, data, length);
+                    } else if (type == MSG_HELLO && length >= 1) {
+                        game.acceptHello(playerSocket, data, length);
+                    } else if (type == MSG_VIEWPORT) {
+                        int cols, rows;
+                        if (decodeViewport(data, length, cols, rows)) {
+                            game.setViewport(playerSocket, cols, rows);
+                        }
+                    } else if (type == MSG_INPUT) {
+                        game.handleInput(colorIndex, data, length);
+                    } else if (type == MSG_INPUT_AT && length >= 4) {
+                        game.handleInput(colorIndex, data + 4, length - 4, true, getU32(data));
+                    }
+                }
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Bad frame from player " << playerIndex + 1 
+                          << ": " << e.what() << std::endl;
+                connectionAlive = false;
             }
-            game.handleInput(colorIndex, buffer[0]); 
         }
     }
     
+    if (connectionAlive) {
+        // Parked for a hot restart: the socket and anything half-read go on
+        // to whoever owns the room next.
+        parser.takeBuffered(unread);
+        game.stashUnread(playerSocket, std::move(unread));
+        return;
+    }
     std::cout << "Player " << playerIndex + 1 << " disconnected" << std::endl;
-    game.removePlayer(playerIndex);
+    game.removePlayer(playerSocket);
     close(playerSocket);
 }
 
-int main() {
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        std::cerr << "Failed to create socket" << std::endl;
-        return 1;
+template <class Game>
+void udpLoop(Game& game, int udpSocket) {
+    trace::nameThread("udp");
+    std::vector<char> packet(UDP_MAX_PACKET);
+    while (true) {
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t n = recvfrom(udpSocket, packet.data(), packet.size(), 0,
+                             reinterpret_cast<sockaddr*>(&from), &fromLen);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "UDP receive failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        game.handleDatagram(packet.data(), static_cast<size_t>(n), from);
     }
+}
 
-    int opt = 1;
-    if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        std::cerr << "setsockopt failed" << std::endl;
-        return 1;
+static int listenUnix(const char* path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0 ||
+        bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(sock, LISTEN_BACKLOG) < 0) {
+        std::cerr << "Unix socket " << path << " unavailable" << std::endl;
+        if (sock >= 0) close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// New side of a hot restart: adopts the running server's sockets and room.
+// Returns the handoff connection, to be answered after the first tick.
+template <class Game>
+static int takeOver(Game& game, int& serverSocket, int& unixSocket, int& udpSocket) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, HANDOFF_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    int peer = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (peer < 0 || connect(peer, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "No running server at " << HANDOFF_SOCKET_PATH << std::endl;
+        if (peer >= 0) close(peer);
+        return -1;
+    }
+    std::vector<int> fds;
+    std::string snapshot;
+    if (!handoff::recvFds(peer, fds) || !handoff::recvBlob(peer, snapshot) ||
+        fds.empty() || snapshot.empty()) {
+        std::cerr << "Handoff interrupted" << std::endl;
+        close(peer);
+        return -1;
+    }
+    uint8_t listeners = static_cast<uint8_t>(snapshot[0]);
+    size_t next = 0;
+    serverSocket = fds[next++];
+    unixSocket = (listeners & 1) && next < fds.size() ? fds[next++] : -1;
+    udpSocket = (listeners & 2) && next < fds.size() ? fds[next++] : -1;
+    try {
+        game.importState(snapshot.data() + 1, snapshot.size() - 1,
+                         std::vector<int>(fds.begin() + next, fds.end()));
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Bad handoff snapshot: " << e.what() << std::endl;
+        close(peer);
+        return -1;
+    }
+    return peer;
+}
+
+// Old side of a hot restart. Parks the connection threads, ships sockets and
+// room, and waits for the new process to tick. On failure the room is handed
+// back to this process and false is returned.
+template <class Game>
+static bool handOff(Game& game, int peer, int serverSocket, int unixSocket, int udpSocket,
+                    std::vector<std::thread>& clientThreads) {
+    std::cout << "Handing off to a new server process..." << std::endl;
+    game.beginHandoff();
+    for (auto& thread : clientThreads) {
+        thread.join();
+    }
+    clientThreads.clear();
+
+    std::vector<int> fds = {serverSocket};
+    std::string snapshot(1, '\0');
+    if (unixSocket >= 0) {
+        fds.push_back(unixSocket);
+        snapshot[0] |= 1;
+    }
+    if (udpSocket >= 0) {
+        fds.push_back(udpSocket);
+        snapshot[0] |= 2;
+    }
+    game.exportState(snapshot, fds);
+
+    char ready = 0;
+    struct pollfd pfd = {peer, POLLIN, 0};
+    bool ok = handoff::sendFds(peer, fds) && handoff::sendBlob(peer, snapshot) &&
+              poll(&pfd, 1, HANDOFF_TIMEOUT_MS) > 0 && recv(peer, &ready, 1, 0) == 1 &&
+              ready == 'R';
+    close(peer);
+    if (!ok) {
+        std::cerr << "Handoff failed, resuming the room here" << std::endl;
+        game.endHandoff();
+    }
+    return ok;
+}
+
+struct ServerOptions {
+    bool takeover = false;
+    std::vector<std::string> modes = {"classic"};  // worker w plays modes[w % size]
+    int workers = 0;                    // 0: one process, no routing
+    int worker = 0;
+    int routeChannel = -1;              // to the coordinator, workers only
+};
+
+struct PendingJoin {
+    int socket;
+    uint64_t deadline;
+};
+
+enum JoinState { JOIN_WAIT, JOIN_NONE, JOIN_ROOM, JOIN_CLOSED };
+
+// Looks at a routed connection's first frame without consuming it, unless it
+// is a MSG_JOIN, which is read off and its room returned.
+static JoinState peekJoin(int socket, uint32_t& room) {
+    char head[FRAME_HEADER_SIZE + 4];
+    ssize_t n = recv(socket, head, sizeof(head), MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) return JOIN_CLOSED;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? JOIN_WAIT : JOIN_CLOSED;
+    if (n < static_cast<ssize_t>(FRAME_HEADER_SIZE)) return JOIN_WAIT;
+    if (static_cast<uint8_t>(head[4]) != MSG_JOIN || getU32(head) != 4) return JOIN_NONE;
+    if (n < static_cast<ssize_t>(sizeof(head))) return JOIN_WAIT;
+    recv(socket, head, sizeof(head), MSG_DONTWAIT);
+    room = getU32(head + FRAME_HEADER_SIZE);
+    return JOIN_ROOM;
+}
+
+static const char* const ADMIN_HELP =
+    "rooms                  this room and the admin sockets of the other workers\n"
+    "players                players with id, state, score and link\n"
+    "snapshot               the full room state text\n"
+    "kick <id>              disconnect a player (id from players)\n"
+    "drain | open           stop or resume admitting new players\n"
+    "close                  drain and disconnect everyone\n"
+    "get                    list tunables\n"
+    "set <tunable> <value>  change a tunable from the next tick\n";
+
+static bool pollReadable(const struct pollfd& pfd) {
+    return (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
+
+// Answers every complete line from readable admin sessions; sessions that
+// hang up, flood or cannot take their reply are dropped. polled[i] is the
+// poll entry of sessions[i].
+template <class Game>
+static void serveAdmin(Game& game, const ServerOptions& options,
+                       std::vector<admin::Session>& sessions, const struct pollfd* polled) {
+    size_t kept = 0;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        admin::Session& session = sessions[i];
+        bool keep = !pollReadable(polled[i]) || admin::readInput(session);
+        std::string line;
+        while (keep && admin::nextLine(session, line)) {
+            std::vector<std::string> words = admin::split(line);
+            if (words.empty()) continue;
+            std::string out, error;
+            if (words[0] == "help") {
+                out = ADMIN_HELP;
+            } else if (words[0] == "rooms" && words.size() == 1) {
+                int rooms = std::max(1, options.workers);
+                for (int w = 0; w < rooms; w++) {
+                    out += "room " + std::to_string(w) + " " + 
+                           options.modes[w % options.modes.size()] + " ";
+                    if (w == options.worker) {
+                        game.adminCommand({"room"}, out);
+                    } else {
+                        out += workers::workerPath(ADMIN_SOCKET_PATH, w) + "\n";
+                    }
+                }
+            } else {
+                error = game.adminCommand(words, out);
+            }
+            out += error.empty() ? "OK\n" : "ERR " + error + "\n";
+            keep = admin::reply(session.fd, out);
+        }
+        if (!keep) {
+            close(session.fd);
+        } else if (kept++ != i) {
+            sessions[kept - 1] = std::move(session);
+        }
+    }
+    sessions.resize(kept);
+}
+
+template <class Rules>
+static int runServer(const ServerOptions& options) {
+    using Game = TronGame<Rules>;
+    bool routed = options.workers > 0;
+    Leaderboard leaderboard;
+    Game game(leaderboard, options.modes[options.worker % options.modes.size()]);
+    int serverSocket = -1, unixSocket = -1, udpSocket = -1;
+    int routeChannel = options.routeChannel;
+    int handoffPeer = -1;               // previous process, until our first tick
+
+    if (routed && !workers::pinToCpu(options.worker)) {
+        std::cerr << "Worker " << options.worker << " could not be pinned to a CPU" << std::endl;
+    }
+
+    if (options.takeover) {
+        handoffPeer = takeOver(game, serverSocket, unixSocket, udpSocket);
+        if (handoffPeer < 0) return 1;
+        game.openOutputs(options.worker, options.workers, true);
+    } else {
+        game.openOutputs(options.worker, options.workers, false);
+        serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (serverSocket < 0) {
+            std::cerr << "Failed to create socket" << std::endl;
+            return 1;
+        }
+
+        int opt = 1;
+        if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+            (routed && setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)))) {
+            std::cerr << "setsockopt failed" << std::endl;
+            return 1;
+        }
+
+        struct sockaddr_in serverAddr;
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_addr.s_addr = INADDR_ANY;
+        serverAddr.sin_port = htons(SERVER_PORT);
+
+        bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
+        listen(serverSocket, LISTEN_BACKLOG);
+
+        if (UDP_ENABLED) {
+            udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+            if (udpSocket >= 0 && routed) {
+                setsockopt(udpSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+            }
+            if (udpSocket < 0 || 
+                bind(udpSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+                std::cerr << "UDP bind failed, UDP transport disabled" << std::endl;
+                if (udpSocket >= 0) close(udpSocket);
+                udpSocket = -1;
+            }
+        }
+
+        // Co-located bots and relays skip the loopback TCP stack. Same framing,
+        // same connection thread; only the listening socket differs.
+        if (UNIX_SOCKET_ENABLED && options.worker == 0) {
+            unixSocket = listenUnix(UNIX_SOCKET_PATH);
+        }
     }
 
-    struct sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(SERVER_PORT);
+    if (udpSocket >= 0) {
+        game.setUdpSocket(udpSocket);
+        std::thread(udpLoop<Game>, std::ref(game), udpSocket).detach();
+    }
+    int handoffListener = routed ? -1 : listenUnix(HANDOFF_SOCKET_PATH);
+    std::string adminPath = workers::workerPath(ADMIN_SOCKET_PATH, options.worker);
+    int adminListener = listenUnix(adminPath.c_str());
+    if (adminListener >= 0) {
+        chmod(adminPath.c_str(), 0600);
+        fcntl(adminListener, F_SETFL, fcntl(adminListener, F_GETFL, 0) | O_NONBLOCK);
+    }
+    std::vector<admin::Session> adminSessions;
+    std::string traceFile = workers::workerPath(TRACE_FILE, options.worker);
+    trace::nameThread("main");
+    trace::installDumpSignal();
 
-    bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-    listen(serverSocket, 2);
+    // Listeners are drained to EAGAIN on every wakeup.
+    for (int listener : {serverSocket, unixSocket}) {
+        if (listener >= 0) fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+    }
 
-    TronGame game;
     std::vector<std::thread> clientThreads;
+    std::vector<PendingJoin> pendingJoins;
+    std::vector<int> admitted;
+    auto startClientThreads = [&game, &clientThreads](const std::vector<int>& sockets) {
+        for (int clientSocket : sockets) {
+            clientThreads.emplace_back(handleClient<Game>, std::ref(game), clientSocket);
+        }
+    };
+    startClientThreads(game.tcpSockets());
+    if (routed) {
+        std::cout << "Worker " << options.worker << "/" << options.workers << " (pid " 
+                  << getpid() << ")" << std::endl;
+    }
     std::cout << "等待玩家连接..." << std::endl;
 
+    // Between ticks the loop sleeps in poll, so connections are accepted
+    // the moment they arrive and join at the next tick boundary. poll, not
+    // select: under a connection storm fds pass FD_SETSIZE.
+    enum { POLL_TCP, POLL_UNIX, POLL_HANDOFF, POLL_ROUTE, POLL_ADMIN, POLL_SESSIONS };
+    std::vector<struct pollfd> polled;
+    uint64_t nextTick = monotonicMs();
     while (true) { 
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(serverSocket, &readfds);
-        
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 1000;
-        
-        if (select(serverSocket + 1, &readfds, NULL, NULL, &timeout) > 0) {
-            int clientSocket = accept(serverSocket, nullptr, nullptr);
-            if (clientSocket >= 0) {
-                game.addPlayer(clientSocket);
-                int assignedIndex = -1;
-                for (size_t i = 0; i < game.getPlayerCount(); i++) {
-                    if (game.getPlayerSocket(i) == clientSocket) {
-                        assignedIndex = i;
-                        break;
+        polled.clear();
+        for (int fd : {serverSocket, unixSocket, handoffListener, routeChannel, adminListener}) {
+            polled.push_back({fd, POLLIN, 0});          // negative fds are skipped
+        }
+        for (const auto& session : adminSessions) {
+            polled.push_back({session.fd, POLLIN, 0});
+        }
+        size_t firstJoin = polled.size();
+        size_t polledJoins = pendingJoins.size();
+        for (const auto& pending : pendingJoins) {
+            polled.push_back({pending.socket, POLLIN, 0});
+        }
+
+        uint64_t now = monotonicMs();
+        int waitMs = nextTick > now ? static_cast<int>(nextTick - now) : 0;
+        int ready;
+        {
+            TRACE_SCOPE("wait");
+            ready = poll(polled.data(), polled.size(), waitMs);
+        }
+
+        if (ready > 0) {
+            TRACE_SCOPE("accept");
+            if (pollReadable(polled[POLL_HANDOFF])) {
+                int peer = accept(handoffListener, nullptr, nullptr);
+                if (peer >= 0 && 
+                    handOff(game, peer, serverSocket, unixSocket, udpSocket, clientThreads)) {
+                    std::cout << "Handed off, exiting" << std::endl;
+                    _exit(0);       // no destructors: the shm ring and sockets live on
+                }
+                startClientThreads(game.tcpSockets());
+                continue;
+            }
+            if (pollReadable(polled[POLL_ROUTE])) {
+                int clientSocket;
+                uint32_t room;
+                if (workers::recvRouted(routeChannel, clientSocket, room)) {
+                    DEBUG_LOG("Routed client for room %u", room);
+                    game.queueJoin(clientSocket);
+                } else {
+                    std::cerr << "Coordinator gone, no more routed clients" << std::endl;
+                    close(routeChannel);
+                    routeChannel = -1;
+                }
+            }
+            serveAdmin(game, options, adminSessions, &polled[POLL_SESSIONS]);
+            if (pollReadable(polled[POLL_ADMIN])) {
+                int fd;
+                while ((fd = accept(adminListener, nullptr, nullptr)) >= 0) {
+                    adminSessions.push_back({fd, ""});
+                }
+            }
+            for (size_t slot : {POLL_TCP, POLL_UNIX}) {
+                if (!pollReadable(polled[slot])) continue;
+                int listener = polled[slot].fd;
+                int clientSocket;
+                while ((clientSocket = accept(listener, nullptr, nullptr)) >= 0) {
+                    if (routed) {
+                        pendingJoins.push_back({clientSocket, 
+                                                monotonicMs() + WORKER_JOIN_WAIT_MS});
+                    } else {
+                        game.queueJoin(clientSocket);
                     }
                 }
-                if (assignedIndex >= 0) {
-                    clientThreads.emplace_back(handleClient, std::ref(game), assignedIndex);
+            }
+        }
+
+        // A routed connection stays here unless its MSG_JOIN names a room
+        // that hashes to another worker. Joins accepted this wakeup were not
+        // polled yet and wait for the next one.
+        now = monotonicMs();
+        size_t keptJoins = 0;
+        for (size_t i = 0; i < pendingJoins.size(); i++) {
+            PendingJoin pending = pendingJoins[i];
+            uint32_t room = 0;
+            JoinState state = i < polledJoins && pollReadable(polled[firstJoin + i])
+                            ? peekJoin(pending.socket, room) : JOIN_WAIT;
+            if (state == JOIN_WAIT && now < pending.deadline) {
+                pendingJoins[keptJoins++] = pending;
+                continue;
+            }
+            int owner = state == JOIN_ROOM ? workers::roomOwner(room, options.workers) 
+                                           : options.worker;
+            if (state == JOIN_CLOSED) {
+                close(pending.socket);
+            } else if (owner != options.worker && routeChannel >= 0) {
+                if (!workers::sendRouted(routeChannel, pending.socket, room)) {
+                    std::cerr << "Failed to route client to room " << room << std::endl;
                 }
+                close(pending.socket);
+            } else {
+                game.queueJoin(pending.socket);
             }
         }
-        
+        pendingJoins.resize(keptJoins);
+
+        if (now < nextTick) continue;
         game.updateGame();
-        
-        usleep(GAME_SPEED_MS * 1000);
+        game.takeAdmitted(admitted);
+        startClientThreads(admitted);
+        if (handoffPeer >= 0) {
+            char resumed = 'R';
+            send(handoffPeer, &resumed, 1, MSG_NOSIGNAL);
+            close(handoffPeer);
+            handoffPeer = -1;
+            std::cout << "Took over the room at tick " << game.currentTick() << std::endl;
+        }
+        trace::dumpIfRequested(traceFile);
+
+        // An overrun tick pushes the schedule back instead of bursting to catch up.
+        int tickMs = game.tickInterval();
+        nextTick += tickMs;
+        now = monotonicMs();
+        if (now >= nextTick) {
+            trace::instant("overrun");
+            nextTick = now + tickMs;
+        }
     }
 
     for (auto& thread : clientThreads) {
@@ -641,5 +1797,113 @@ int main() {
     }
 
     close(serverSocket);
+    if (unixSocket >= 0) {
+        close(unixSocket);
+        unlink(UNIX_SOCKET_PATH);
+    }
+    if (adminListener >= 0) {
+        close(adminListener);
+        unlink(adminPath.c_str());
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+struct GameMode {
+    const char* name;
+    const char* description;
+    int (*run)(const ServerOptions&);
+};
+
+static const GameMode gameModes[] = {
+    {"classic", "walls, own trail passable, timed respawn", runServer<ClassicRules>},
+    {"wrap", "edges wrap around", runServer<WrapRules>},
+    {"decay", "trails fade, own trail kills", runServer<DecayRules>},
+    {"rounds", "own trail kills, kills score, respawn when one is left", runServer<RoundsRules>},
+};
+
+static const GameMode* findMode(const std::string& name) {
+    for (const auto& mode : gameModes) {
+        if (name == mode.name) return &mode;
+    }
+    return nullptr;
+}
+
+static int runRoom(const ServerOptions& options) {
+    const GameMode* mode = findMode(options.modes[options.worker % options.modes.size()]);
+    std::cout << "Game mode: " << mode->name << " (" << mode->description << ")" << std::endl;
+    return mode->run(options);
+}
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--takeover | --workers N] [--mode M[,M...]]" << std::endl
+              << "  modes:";
+    for (const auto& mode : gameModes) {
+        std::cerr << " " << mode.name;
+    }
+    std::cerr << std::endl;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--takeover")) {
+            options.takeover = true;
+        } else if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+            options.workers = atoi(argv[++i]);
+            if (options.workers <= 0) {
+                options.workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+        } else if (!strcmp(argv[i], "--mode") && i + 1 < argc) {
+            options.modes.clear();
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!findMode(name)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.modes.push_back(name);
+            }
+            if (options.modes.empty()) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!options.workers) return runRoom(options);
+    if (options.takeover) {
+        std::cerr << "--takeover cannot be combined with --workers" << std::endl;
+        return 1;
+    }
+
+    // Each worker owns one room and one end of a channel to this process,
+    // which stays behind to pass routed connections between workers.
+    std::vector<int> channels;
+    std::vector<pid_t> pids;
+    for (int w = 0; w < options.workers; w++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) < 0) {
+            std::cerr << "socketpair failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "fork failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        if (pid == 0) {
+            close(pair[0]);
+            for (int channel : channels) close(channel);
+            options.worker = w;
+            options.routeChannel = pair[1];
+            return runRoom(options);
+        }
+        close(pair[1]);
+        channels.push_back(pair[0]);
+        pids.push_back(pid);
+    }
+    return workers::coordinate(channels, pids);
+}
@@ -0,0 +1,201 @@
+#ifndef TRON_SHM_RING_H
+#define TRON_SHM_RING_H
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+
+// Single-writer, many-reader frame ring in POSIX shared memory. The server
+// publishes each tick's encoded state frame once; local readers map the same
+// segment and pick up the newest frame with plain loads, so adding a reader
+// costs the server nothing and a reader no syscall per frame.
+//
+// Each slot is a seqlock: the writer zeroes the slot's sequence, copies the
+// frame in and then stores the new sequence. A reader checks the sequence
+// before and after looking at the bytes and discards the read if it moved.
+namespace shm {
+
+constexpr uint32_t MAGIC = 0x54524E31;     // "TRN1"
+
+struct Header {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    uint32_t reserved;
+    std::atomic<uint64_t> writeSeq;         // sequence of the newest complete frame
+};
+static_assert(sizeof(Header) <= 64, "header must fit before the first slot");
+
+struct Slot {
+    std::atomic<uint64_t> seq;
+    uint32_t length;
+    uint32_t reserved;
+    // followed by slotSize bytes of frame data
+};
+
+inline size_t slotStride(uint32_t slotSize) {
+    return (sizeof(Slot) + slotSize + 63) & ~size_t(63);
+}
+
+inline size_t segmentSize(uint32_t slotCount, uint32_t slotSize) {
+    return 64 + slotStride(slotSize) * slotCount;
+}
+
+}  // namespace shm
+
+class ShmFrameWriter {
+private:
+    std::string name;
+    char* base = nullptr;
+    size_t size = 0;
+    shm::Header* header = nullptr;
+    uint64_t seq = 0;
+
+    shm::Slot* slot(uint64_t s) {
+        return reinterpret_cast<shm::Slot*>(
+            base + 64 + shm::slotStride(header->slotSize) * (s % header->slotCount));
+    }
+
+public:
+    ~ShmFrameWriter() {
+        if (base) {
+            munmap(base, size);
+            shm_unlink(name.c_str());
+        }
+    }
+
+    bool create(const char* segmentName, uint32_t slotCount, uint32_t slotSize) {
+        name = segmentName;
+        size = shm::segmentSize(slotCount, slotSize);
+        int fd = shm_open(segmentName, O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, size) < 0) {
+            close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return false;
+        base = static_cast<char*>(mem);
+        memset(base, 0, size);
+        header = new (base) shm::Header();
+        header->slotCount = slotCount;
+        header->slotSize = slotSize;
+        header->writeSeq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = shm::MAGIC;
+        return true;
+    }
+
+    // Maps a segment a previous writer handed over, keeping its frames and
+    // sequence so attached readers never see the ring restart. Fails, touching
+    // nothing, if there is no segment or its geometry differs.
+    bool adopt(const char* segmentName, uint32_t slotCount, uint32_t slotSize) {
+        size_t want = shm::segmentSize(slotCount, slotSize);
+        int fd = shm_open(segmentName, O_RDWR, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || size_t(st.st_size) != want) {
+            close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return false;
+        shm::Header* h = static_cast<shm::Header*>(mem);
+        if (h->magic != shm::MAGIC || h->slotCount != slotCount || h->slotSize != slotSize) {
+            munmap(mem, want);
+            return false;
+        }
+        name = segmentName;
+        size = want;
+        base = static_cast<char*>(mem);
+        header = h;
+        seq = header->writeSeq.load(std::memory_order_acquire);
+        return true;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+
+    bool publish(const char* data, size_t length) {
+        if (!base || length > header->slotSize) return false;
+        uint64_t s = ++seq;
+        shm::Slot* sl = slot(s);
+        sl->seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(reinterpret_cast<char*>(sl + 1), data, length);
+        sl->length = static_cast<uint32_t>(length);
+        sl->seq.store(s, std::memory_order_release);
+        header->writeSeq.store(s, std::memory_order_release);
+        return true;
+    }
+};
+
+class ShmFrameReader {
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+    const shm::Header* header = nullptr;
+
+public:
+    ~ShmFrameReader() {
+        if (base) munmap(const_cast<char*>(base), size);
+    }
+
+    bool open(const char* segmentName) {
+        int fd = shm_open(segmentName, O_RDONLY, 0);
+        if (fd < 0) return false;
+        void* mem = mmap(nullptr, sizeof(shm::Header), PROT_READ, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        const shm::Header* h = static_cast<const shm::Header*>(mem);
+        bool valid = h->magic == shm::MAGIC;
+        uint32_t slotCount = h->slotCount, slotSize = h->slotSize;
+        munmap(mem, sizeof(shm::Header));
+        if (!valid) {
+            close(fd);
+            return false;
+        }
+        size = shm::segmentSize(slotCount, slotSize);
+        mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return false;
+        base = static_cast<const char*>(mem);
+        header = reinterpret_cast<const shm::Header*>(base);
+        return true;
+    }
+
+    uint64_t latestSeq() const {
+        return header->writeSeq.load(std::memory_order_acquire);
+    }
+
+    // Hands the newest frame to consume(data, length) in place, if it is newer
+    // than lastSeq. Returns true only when the slot was not overwritten while
+    // consume ran; on false whatever consume produced must be thrown away.
+    template <typename Consume>
+    bool readLatest(uint64_t& lastSeq, Consume&& consume) const {
+        uint64_t s = latestSeq();
+        if (s == lastSeq) return false;
+        const shm::Slot* sl = reinterpret_cast<const shm::Slot*>(
+            base + 64 + shm::slotStride(header->slotSize) * (s % header->slotCount));
+        if (sl->seq.load(std::memory_order_acquire) != s) return false;
+        uint32_t length = sl->length;
+        if (length > header->slotSize) return false;
+        consume(reinterpret_cast<const char*>(sl + 1), static_cast<size_t>(length));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sl->seq.load(std::memory_order_relaxed) != s) return false;
+        lastSeq = s;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TRON_STATE_HASH_H
+#define TRON_STATE_HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Zobrist hashing of the board. Every (cell, value) pair has a fixed 64-bit
+// key computed by a mixer instead of looked up in a random table, so keys
+// are the same in every build, board layout and process; the simulation XORs
+// a cell's old key out and its new key in on each write, which keeps the
+// board hash current in O(1). Empty cells have key 0: an empty board is 0.
+inline uint64_t hashMix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t zobristCell(size_t index, int value) {
+    if (!value) return 0;
+    return hashMix((static_cast<uint64_t>(index) << 8 | static_cast<uint8_t>(value)) +
+                   0x9E3779B97F4A7C15ULL);
+}
+
+// From scratch, for checking the incremental value and for clients, which
+// only see the cells.
+inline uint64_t boardHash(const int* cells, size_t count) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < count; i++) {
+        h ^= zobristCell(i, cells[i]);
+    }
+    return h;
+}
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef TRON_STATS_STORE_H
+#define TRON_STATS_STORE_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Persistent player stats in one memory-mapped file: a fixed header followed
+// by an open-addressing table (linear probing, no deletes) of fixed-size
+// records keyed on a hash of the player's name. A lookup or update touches
+// one or two records in place, so opening the store costs the same for ten
+// players or ten million. Dirty pages reach the file through the page cache;
+// sync() asks for write-back without waiting.
+//
+// Past 5/8 load the table starts doubling into a fresh file. Creating it is
+// only a truncate and a map; records then move over a slice per migrate()
+// call, or on their next get(), while lookups still fall back to the old
+// table. Once all have moved, the old map goes, and a background thread
+// fsyncs the new file and renames it over the old one. Until that rename
+// the old file, which migration only reads, is the copy on disk.
+namespace stats {
+
+constexpr uint32_t MAGIC = 0x54525331;     // "TRS1"
+constexpr uint32_t VERSION = 2;            // 1 keyed records on connection fds
+
+// Stats key for a player name: 64-bit FNV-1a, never 0, which stands for an
+// anonymous player with no record.
+inline int64_t keyForName(const char* name, size_t length) {
+    if (!length) return 0;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ static_cast<uint8_t>(name[i])) * 0x100000001B3ULL;
+    }
+    return h ? static_cast<int64_t>(h) : 1;
+}
+
+struct Record {
+    int64_t id;
+    uint32_t used;                         // 0 = empty slot
+    int32_t highScore;
+    uint32_t games;                        // sessions joined
+    uint32_t kills;
+    uint32_t deaths;
+    uint32_t reserved;
+    uint64_t survivalMs;
+};
+static_assert(sizeof(Record) == 40, "stats record layout is part of the file format");
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t capacity;                     // power of two
+    uint64_t count;
+    char pad[32];
+};
+static_assert(sizeof(Header) == 64, "stats header layout is part of the file format");
+
+class Store {
+private:
+    std::string path;
+    int fd = -1;
+    Header* header = nullptr;
+    Record* table = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t generation = 0;
+
+    // The table being migrated out of while growing; oldHeader is null otherwise.
+    int oldFd = -1;
+    Header* oldHeader = nullptr;
+    Record* oldTable = nullptr;
+    uint64_t migrated = 0;                 // old slots copied so far
+    uint64_t fresh = 0;                    // ids first inserted during growth
+
+    // fsync and rename of the last grown file, off the caller's thread.
+    std::thread finisher;
+    std::atomic<bool> finished{false};
+    std::atomic<bool> renamed{false};
+
+    static uint64_t hash(int64_t id) {
+        uint64_t z = static_cast<uint64_t>(id) + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static size_t fileBytes(uint64_t capacity) {
+        return sizeof(Header) + capacity * sizeof(Record);
+    }
+
+    // The slot holding id, or the empty slot where it would go.
+    static Record* probe(Header* h, Record* t, int64_t id) {
+        uint64_t mask = h->capacity - 1;
+        for (uint64_t i = hash(id) & mask;; i = (i + 1) & mask) {
+            if (!t[i].used || t[i].id == id) return &t[i];
+        }
+    }
+
+    static bool mapFile(int file, size_t bytes, Header*& h) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (p == MAP_FAILED) return false;
+        h = static_cast<Header*>(p);
+        return true;
+    }
+
+    static bool create(const std::string& at, uint64_t capacity, int& file, Header*& h) {
+        file = ::open(at.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file < 0) return false;
+        if (ftruncate(file, fileBytes(capacity)) != 0 || !mapFile(file, fileBytes(capacity), h)) {
+            ::close(file);
+            return false;
+        }
+        h->magic = MAGIC;
+        h->version = VERSION;
+        h->recordSize = sizeof(Record);
+        h->capacity = capacity;
+        h->count = 0;
+        return true;
+    }
+
+    // Swaps in an empty table of twice the capacity and keeps the current one
+    // as the old table; records follow in migrate() and get().
+    void startGrowth() {
+        int newFd;
+        Header* h;
+        if (!create(path + ".tmp", header->capacity * 2, newFd, h)) return;
+        oldFd = fd;
+        oldHeader = header;
+        oldTable = table;
+        migrated = 0;
+        fresh = 0;
+        fd = newFd;
+        header = h;
+        table = reinterpret_cast<Record*>(h + 1);
+        mappedBytes = fileBytes(h->capacity);
+        generation++;
+    }
+
+    void finishGrowth() {
+        munmap(oldHeader, fileBytes(oldHeader->capacity));
+        ::close(oldFd);
+        oldFd = -1;
+        oldHeader = nullptr;
+        oldTable = nullptr;
+        generation++;
+        finished = false;
+        renamed = false;
+        int file = fd;
+        std::string from = path + ".tmp", to = path;
+        finisher = std::thread([this, file, from, to]() {
+            renamed = fsync(file) == 0 && rename(from.c_str(), to.c_str()) == 0;
+            finished = true;
+        });
+    }
+
+    // Waits for the last growth's rename; one that failed is retried here.
+    void joinFinisher() {
+        if (!finisher.joinable()) return;
+        finisher.join();
+        if (!renamed) renamed = rename((path + ".tmp").c_str(), path.c_str()) == 0;
+    }
+
+public:
+    Store() = default;
+    Store(const Store&) = delete;
+    Store& operator=(const Store&) = delete;
+    ~Store() { close(); }
+
+    // Opens or creates the store; `created` tells the caller the file is new.
+    // False (errno set, or EINVAL for a foreign file) leaves the store closed.
+    bool open(const std::string& file, uint64_t initialCapacity, bool& created) {
+        close();
+        path = file;
+        created = false;
+        fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT) return false;
+            uint64_t capacity = 16;
+            while (capacity < initialCapacity) capacity *= 2;
+            if (!create(path, capacity, fd, header)) return false;
+            created = true;
+        } else {
+            struct stat st;
+            Header probeHeader;
+            if (fstat(fd, &st) != 0 ||
+                pread(fd, &probeHeader, sizeof(probeHeader), 0) != sizeof(probeHeader) ||
+                probeHeader.magic != MAGIC || probeHeader.version != VERSION ||
+                probeHeader.recordSize != sizeof(Record) || !probeHeader.capacity ||
+                (probeHeader.capacity & (probeHeader.capacity - 1)) ||
+                static_cast<uint64_t>(st.st_size) != fileBytes(probeHeader.capacity)) {
+                ::close(fd);
+                fd = -1;
+                errno = EINVAL;
+                return false;
+            }
+            if (!mapFile(fd, st.st_size, header)) {
+                ::close(fd);
+                fd = -1;
+                return false;
+            }
+        }
+        mappedBytes = fileBytes(header->capacity);
+        table = reinterpret_cast<Record*>(header + 1);
+        return true;
+    }
+
+    // Finishes any growth in place and waits for its rename, so the file at
+    // the store's path is the current one; this may take a full pass.
+    void settle() {
+        if (oldHeader) migrate(oldHeader->capacity);
+        joinFinisher();
+    }
+
+    void close() {
+        settle();
+        if (header) {
+            msync(header, mappedBytes, MS_SYNC);
+            munmap(header, mappedBytes);
+        }
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        header = nullptr;
+        table = nullptr;
+        mappedBytes = 0;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    uint64_t size() const {
+        if (!header) return 0;
+        return oldHeader ? oldHeader->count + fresh : header->count;
+    }
+    uint64_t capacity() const { return header ? header->capacity : 0; }
+
+    // While true, slot() scans see only the records migrated so far.
+    bool growing() const { return oldHeader != nullptr; }
+
+    // Bumped when growth starts and ends; slot() scans restart on it.
+    uint64_t layout() const { return generation; }
+
+    const Record& slot(uint64_t i) const { return table[i]; }
+
+    const Record* find(int64_t id) const {
+        if (!header) return nullptr;
+        const Record* r = probe(header, table, id);
+        if (!r->used && oldHeader) r = probe(oldHeader, oldTable, id);
+        return r->used ? r : nullptr;
+    }
+
+    // The record for id, inserted zeroed if new. The pointer is valid until
+    // the next get() or migrate(); nullptr only when the store is closed or
+    // full.
+    Record* get(int64_t id) {
+        if (!header) return nullptr;
+        Record* r = probe(header, table, id);
+        if (r->used) return r;
+        const Record* old = oldHeader ? probe(oldHeader, oldTable, id) : nullptr;
+        if (old && old->used) {
+            *r = *old;
+            header->count++;
+            return r;
+        }
+        if (finisher.joinable() && finished) joinFinisher();
+        if ((size() + 1) * 4 > header->capacity * 3) {
+            // Inserts outran migration, or the last rename is still in
+            // flight: catch up in place rather than overfill the table.
+            if (oldHeader) migrate(oldHeader->capacity);
+            joinFinisher();
+        }
+        if (!oldHeader && !finisher.joinable() && (header->count + 1) * 8 > header->capacity * 5) {
+            startGrowth();
+        }
+        if ((size() + 1) * 4 > header->capacity * 3) return nullptr;
+        r = probe(header, table, id);
+        memset(r, 0, sizeof(*r));
+        r->id = id;
+        r->used = 1;
+        header->count++;
+        if (oldHeader) fresh++;
+        return r;
+    }
+
+    // Copies up to `slots` old slots into the grown table; a no-op unless
+    // growing. The last call unmaps the old table and starts the rename.
+    void migrate(uint64_t slots) {
+        if (!oldHeader) return;
+        uint64_t end = migrated + std::min(slots, oldHeader->capacity - migrated);
+        for (; migrated < end; migrated++) {
+            const Record& old = oldTable[migrated];
+            if (!old.used) continue;
+            Record* r = probe(header, table, old.id);
+            if (r->used) continue;          // moved over by get() already
+            *r = old;
+            header->count++;
+        }
+        if (migrated == oldHeader->capacity) finishGrowth();
+    }
+
+    void sync() {
+        if (header) msync(header, mappedBytes, MS_ASYNC);
+    }
+};
+
+}  // namespace stats
+
+#endif
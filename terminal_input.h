@@ -0,0 +1,140 @@
+#ifndef TRON_TERMINAL_INPUT_H
+#define TRON_TERMINAL_INPUT_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <termios.h>
+#include "config.h"
+
+// Keyboard input for the client. The terminal is switched to non-canonical,
+// no-echo mode once for the whole session and restored on exit or on a fatal
+// signal. Each read drains everything the terminal has buffered, decodes
+// arrow-key escape sequences and maps the result through a remappable table,
+// so a burst of keys costs one syscall instead of three per key.
+namespace terminal {
+
+inline struct termios& savedState() {
+    static struct termios state;
+    return state;
+}
+
+inline volatile sig_atomic_t& rawActive() {
+    static volatile sig_atomic_t active = 0;
+    return active;
+}
+
+inline void restore() {
+    if (!rawActive()) return;
+    tcsetattr(STDIN_FILENO, TCSANOW, &savedState());
+    rawActive() = 0;
+    const char showCursor[] = "\033[?25h";
+    ssize_t ignored = write(STDOUT_FILENO, showCursor, sizeof(showCursor) - 1);
+    (void)ignored;
+}
+
+inline void onFatalSignal(int sig) {
+    restore();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// ISIG stays on so Ctrl-C still interrupts; the handlers put the terminal back.
+inline bool enableRaw() {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &savedState()) < 0) return false;
+    struct termios raw = savedState();
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) < 0) return false;
+    rawActive() = 1;
+    atexit(restore);
+    signal(SIGINT, onFatalSignal);
+    signal(SIGTERM, onFatalSignal);
+    signal(SIGHUP, onFatalSignal);
+    return true;
+}
+
+}  // namespace terminal
+
+// Turns raw terminal bytes into game keys. Arrow keys arrive as ESC [ A..D
+// (or ESC O A..D in application mode) and are translated to the WASD keys
+// before remapping. A sequence split across reads is kept for the next call.
+class KeyDecoder {
+private:
+    char keymap[256];
+    std::string partial;
+
+    static int parseKey(const std::string& token) {
+        if (token == "up") return KEY_UP;
+        if (token == "down") return KEY_DOWN;
+        if (token == "left") return KEY_LEFT;
+        if (token == "right") return KEY_RIGHT;
+        if (token == "quit") return 'q';
+        if (token.size() == 1) return static_cast<unsigned char>(token[0]);
+        return -1;
+    }
+
+public:
+    KeyDecoder() {
+        for (int i = 0; i < 256; i++) keymap[i] = static_cast<char>(i);
+        keymap['W'] = KEY_UP;
+        keymap['S'] = KEY_DOWN;
+        keymap['A'] = KEY_LEFT;
+        keymap['D'] = KEY_RIGHT;
+    }
+
+    // Lines of "<from> <to>", each a single character or up/down/left/right/quit,
+    // e.g. "i up" or "up w". Missing files leave the defaults.
+    void loadKeymap(const char* path) {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream ss(line);
+            std::string from, to;
+            if (!(ss >> from >> to) || from[0] == '#') continue;
+            int f = parseKey(from), t = parseKey(to);
+            if (f >= 0 && t >= 0) keymap[f] = static_cast<char>(t);
+        }
+    }
+
+    void decode(const char* data, size_t length, std::string& keys) {
+        partial.append(data, length);
+        size_t i = 0;
+        while (i < partial.size()) {
+            char c = partial[i];
+            if (c != '\033') {
+                keys.push_back(keymap[static_cast<unsigned char>(c)]);
+                i++;
+                continue;
+            }
+            if (i + 1 >= partial.size()) break;                 // wait for the rest
+            char kind = partial[i + 1];
+            if (kind != '[' && kind != 'O') {                   // bare ESC, drop it
+                i++;
+                continue;
+            }
+            if (i + 2 >= partial.size()) break;
+            char code = partial[i + 2];
+            const char arrows[4] = {KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT};
+            if (code >= 'A' && code <= 'D') {
+                keys.push_back(keymap[static_cast<unsigned char>(arrows[code - 'A'])]);
+            }
+            i += 3;
+        }
+        partial.erase(0, i);
+    }
+};
+
+// Reads whatever stdin has buffered in one call and decodes it.
+inline ssize_t readKeys(KeyDecoder& decoder, std::string& keys) {
+    char buffer[256];
+    ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (n > 0) decoder.decode(buffer, static_cast<size_t>(n), keys);
+    return n;
+}
+
+#endif
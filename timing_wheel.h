@@ -0,0 +1,177 @@
+#ifndef TRON_TIMING_WHEEL_H
+#define TRON_TIMING_WHEEL_H
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include "config.h"
+
+inline uint64_t monotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Hierarchical timing wheel (4 levels x 64 slots). Scheduling, rescheduling
+// and cancelling are O(1); advancing costs one slot visit per elapsed tick plus
+// an occasional cascade of a higher-level slot. Timers carry a (kind, key) pair
+// instead of a callback so the owner decides what an expiry means.
+class TimingWheel {
+public:
+    using TimerId = uint64_t;
+    static constexpr TimerId INVALID_TIMER = 0;
+
+private:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int SLOT_MASK = SLOTS - 1;
+    static constexpr int LEVELS = 4;
+    static constexpr uint32_t SENTINELS = SLOTS * LEVELS;
+    static constexpr uint64_t MAX_DELTA = (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+
+    struct Node {
+        uint32_t prev, next;
+        uint32_t generation;
+        bool linked;
+        uint64_t expires;
+        int kind;
+        int key;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint64_t tickMs;
+    uint64_t currentTick;
+    size_t pendingCount = 0;
+
+    void unlink(uint32_t i) {
+        Node& n = nodes[i];
+        nodes[n.prev].next = n.next;
+        nodes[n.next].prev = n.prev;
+        n.linked = false;
+    }
+
+    void linkBefore(uint32_t sentinel, uint32_t i) {
+        Node& n = nodes[i];
+        n.prev = nodes[sentinel].prev;
+        n.next = sentinel;
+        nodes[n.prev].next = i;
+        nodes[sentinel].prev = i;
+        n.linked = true;
+    }
+
+    void place(uint32_t i) {
+        uint64_t expires = nodes[i].expires;
+        uint64_t delta = expires - currentTick;
+        if (delta > MAX_DELTA) {
+            expires = currentTick + MAX_DELTA;
+            delta = MAX_DELTA;
+        }
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        uint32_t slot = (expires >> (SLOT_BITS * level)) & SLOT_MASK;
+        linkBefore(level * SLOTS + slot, i);
+    }
+
+    uint64_t toTick(uint64_t deadlineMs) const {
+        uint64_t tick = (deadlineMs + tickMs - 1) / tickMs;
+        return tick > currentTick ? tick : currentTick + 1;
+    }
+
+    void release(uint32_t i) {
+        nodes[i].generation++;
+        freeNodes.push_back(i);
+        pendingCount--;
+    }
+
+    void cascade(int level) {
+        uint32_t slot = (currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+        uint32_t sentinel = level * SLOTS + slot;
+        while (nodes[sentinel].next != sentinel) {
+            uint32_t i = nodes[sentinel].next;
+            unlink(i);
+            place(i);
+        }
+    }
+
+    bool resolve(TimerId id, uint32_t& index) const {
+        index = static_cast<uint32_t>(id);
+        return id != INVALID_TIMER && index >= SENTINELS && index < nodes.size() &&
+               nodes[index].generation == static_cast<uint32_t>(id >> 32) &&
+               nodes[index].linked;
+    }
+
+public:
+    TimingWheel(uint64_t resolutionMs, uint64_t nowMs)
+        : nodes(SENTINELS), tickMs(resolutionMs ? resolutionMs : 1),
+          currentTick(nowMs / tickMs) {
+        for (uint32_t i = 0; i < SENTINELS; i++) {
+            nodes[i] = {i, i, 0, false, 0, 0, 0};
+        }
+    }
+
+    TimerId schedule(uint64_t deadlineMs, int kind, int key) {
+        uint32_t i;
+        if (!freeNodes.empty()) {
+            i = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            i = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({0, 0, 1, false, 0, 0, 0});
+        }
+        nodes[i].expires = toTick(deadlineMs);
+        nodes[i].kind = kind;
+        nodes[i].key = key;
+        place(i);
+        pendingCount++;
+        return (uint64_t(nodes[i].generation) << 32) | i;
+    }
+
+    // Moves a pending timer to a new deadline; schedules a fresh one if it already fired.
+    TimerId reschedule(TimerId id, uint64_t deadlineMs, int kind, int key) {
+        uint32_t i;
+        if (!resolve(id, i)) {
+            return schedule(deadlineMs, kind, key);
+        }
+        unlink(i);
+        nodes[i].expires = toTick(deadlineMs);
+        place(i);
+        return id;
+    }
+
+    void cancel(TimerId& id) {
+        uint32_t i;
+        if (resolve(id, i)) {
+            unlink(i);
+            release(i);
+        }
+        id = INVALID_TIMER;
+    }
+
+    size_t pending() const { return pendingCount; }
+
+    // Fires every timer due at or before nowMs, calling onExpire(kind, key).
+    template <typename F>
+    void advance(uint64_t nowMs, F&& onExpire) {
+        uint64_t target = nowMs / tickMs;
+        while (currentTick < target) {
+            currentTick++;
+            for (int level = 1; level < LEVELS; level++) {
+                if ((currentTick & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+                cascade(level);
+            }
+            uint32_t sentinel = currentTick & SLOT_MASK;
+            while (nodes[sentinel].next != sentinel) {
+                uint32_t i = nodes[sentinel].next;
+                unlink(i);
+                int kind = nodes[i].kind;
+                int key = nodes[i].key;
+                release(i);
+                onExpire(kind, key);
+            }
+        }
+    }
+};
+
+#endif
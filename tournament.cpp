@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include "config.h"
+#include "tron_sim.h"
+
+// Headless tournament: plays many fixed-seed matches between entrants (bot
+// levels, 0 for random turns) across all cores and reports win rate, survival
+// and score distribution per entrant. Seats rotate between matches so spawn
+// and move order favour no one. Scoring can be overridden on the command line
+// to try out balance changes offline.
+
+struct TournamentOptions {
+    int matches = 1000;
+    int ticks = 1000;
+    int threads = 0;
+    uint64_t seed = 1;
+    std::vector<int> entrants = {BOT_LEVEL_EASY, BOT_LEVEL_MEDIUM, BOT_LEVEL_HARD, 0};
+    int survivalPoints = SCORE_SURVIVAL_TIME;
+    int killPoints = SCORE_KILL_POINTS;
+    double transferRate = SCORE_TRANSFER_RATE;
+};
+
+struct EntrantStats {
+    double wins = 0;            // ties split the win
+    uint64_t aliveTicks = 0;
+    uint64_t lives = 0;
+    uint64_t deaths = 0;
+    uint64_t kills = 0;
+    std::vector<int> scores;    // points earned per match
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [--matches N] [--ticks N] [--threads N] [--seed N]"
+              << " [--entrants L,L,...] [--survival N] [--kill N] [--transfer F]" << std::endl
+              << "  entrants are 2-" << MAX_PLAYERS << " bot levels 0-" << BOT_MAX_DEPTH
+              << " (0: random turns)" << std::endl;
+}
+
+static bool parseEntrants(const char* value, std::vector<int>& entrants) {
+    entrants.clear();
+    const char* p = value;
+    while (*p) {
+        char* end;
+        long level = strtol(p, &end, 10);
+        if (end == p || level < 0 || level > BOT_MAX_DEPTH) return false;
+        entrants.push_back(static_cast<int>(level));
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return entrants.size() >= 2 && entrants.size() <= MAX_PLAYERS;
+}
+
+static bool parseOptions(int argc, char** argv, TournamentOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (!strcmp(argv[i - 1], "--matches")) opt.matches = atoi(value);
+        else if (!strcmp(argv[i - 1], "--ticks")) opt.ticks = atoi(value);
+        else if (!strcmp(argv[i - 1], "--threads")) opt.threads = atoi(value);
+        else if (!strcmp(argv[i - 1], "--seed")) opt.seed = strtoull(value, nullptr, 10);
+        else if (!strcmp(argv[i - 1], "--entrants")) {
+            if (!parseEntrants(value, opt.entrants)) return false;
+        }
+        else if (!strcmp(argv[i - 1], "--survival")) opt.survivalPoints = atoi(value);
+        else if (!strcmp(argv[i - 1], "--kill")) opt.killPoints = atoi(value);
+        else if (!strcmp(argv[i - 1], "--transfer")) opt.transferRate = atof(value);
+        else return false;
+    }
+    return opt.matches > 0 && opt.ticks > 0;
+}
+
+// Player ids are entrant numbers, so events map straight back to stats.
+static void runMatch(const TournamentOptions& opt, int match,
+                     SimBotDriver<ClassicRules>& bots, std::vector<SimInput>& inputs,
+                     std::vector<SimEvent>& events, std::vector<EntrantStats>& stats) {
+    int n = static_cast<int>(opt.entrants.size());
+    SimState sim;
+    simInit(sim, opt.seed + match);
+    sim.survivalPoints = opt.survivalPoints;
+    sim.killPoints = opt.killPoints;
+    sim.transferRate = opt.transferRate;
+    for (int seat = 0; seat < n; seat++) {
+        int entrant = (seat + match) % n;
+        simAddPlayer(sim, entrant, 0, opt.entrants[entrant], events);
+        stats[entrant].lives++;
+    }
+
+    int earned[MAX_PLAYERS] = {};
+    static const char keys[4] = {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT};
+    for (int t = 0; t < opt.ticks; t++) {
+        inputs.clear();
+        events.clear();
+        bots.decide(sim, inputs);
+        for (const auto& p : sim.players) {
+            if (p.botLevel || !p.alive) continue;
+            uint64_t r = simRandom(sim);
+            if ((r & 7) == 0) inputs.push_back({p.id, keys[(r >> 3) & 3]});
+        }
+        simStep(sim, inputs.data(), inputs.size(), events);
+        for (const auto& p : sim.players) {
+            if (p.alive) stats[p.id].aliveTicks++;
+        }
+        for (const auto& e : events) {
+            if (e.type == SIM_EVENT_RESPAWN) {
+                stats[e.playerId].lives++;
+            } else if (e.type == SIM_EVENT_DEATH) {
+                stats[e.playerId].deaths++;
+                earned[e.playerId] += e.score;
+                if (e.killerId != SIM_NO_PLAYER) stats[e.killerId].kills++;
+            }
+        }
+    }
+
+    int best = INT_MIN, winners = 0;
+    for (const auto& p : sim.players) {
+        earned[p.id] += p.score;
+        if (earned[p.id] > best) {
+            best = earned[p.id];
+            winners = 1;
+        } else if (earned[p.id] == best) {
+            winners++;
+        }
+    }
+    for (int e = 0; e < n; e++) {
+        stats[e].scores.push_back(earned[e]);
+        if (earned[e] == best) stats[e].wins += 1.0 / winners;
+    }
+}
+
+static int percentile(const std::vector<int>& sorted, int pct) {
+    if (sorted.empty()) return 0;
+    return sorted[(sorted.size() - 1) * pct / 100];
+}
+
+int main(int argc, char** argv) {
+    TournamentOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.threads <= 0) {
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    int n = static_cast<int>(opt.entrants.size());
+
+    std::atomic<int> nextMatch{0};
+    std::vector<std::vector<EntrantStats>> results(opt.threads, std::vector<EntrantStats>(n));
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int w = 0; w < opt.threads; w++) {
+        workers.emplace_back([&opt, &nextMatch, &results, w]() {
+            SimBotDriver<ClassicRules> bots;
+            std::vector<SimInput> inputs;
+            std::vector<SimEvent> events;
+            int match;
+            while ((match = nextMatch.fetch_add(1)) < opt.matches) {
+                runMatch(opt, match, bots, inputs, events, results[w]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::vector<EntrantStats> sum(n);
+    for (const auto& thread : results) {
+        for (int e = 0; e < n; e++) {
+            sum[e].wins += thread[e].wins;
+            sum[e].aliveTicks += thread[e].aliveTicks;
+            sum[e].lives += thread[e].lives;
+            sum[e].deaths += thread[e].deaths;
+            sum[e].kills += thread[e].kills;
+            sum[e].scores.insert(sum[e].scores.end(),
+                                 thread[e].scores.begin(), thread[e].scores.end());
+        }
+    }
+
+    printf("matches:%d ticks:%d threads:%d seed:%llu\n", opt.matches, opt.ticks, opt.threads,
+           (unsigned long long)opt.seed);
+    printf("scoring: survival:%d kill:%d transfer:%.2f\n",
+           opt.survivalPoints, opt.killPoints, opt.transferRate);
+    printf("%-8s %5s %7s %9s %9s %7s %7s %7s %7s %7s %7s\n", "entrant", "level", "win%",
+           "alive%", "life", "deaths", "kills", "mean", "p10", "p50", "p90");
+    for (int e = 0; e < n; e++) {
+        EntrantStats& s = sum[e];
+        std::sort(s.scores.begin(), s.scores.end());
+        double mean = 0;
+        for (int score : s.scores) mean += score;
+        mean /= s.scores.size();
+        printf("%-8d %5d %6.1f%% %8.1f%% %9.1f %7llu %7llu %7.0f %7d %7d %7d\n", e,
+               opt.entrants[e], 100.0 * s.wins / opt.matches,
+               100.0 * s.aliveTicks / (double(opt.matches) * opt.ticks),
+               double(s.aliveTicks) / std::max<uint64_t>(1, s.lives),
+               (unsigned long long)s.deaths, (unsigned long long)s.kills, mean,
+               percentile(s.scores, 10), percentile(s.scores, 50), percentile(s.scores, 90));
+    }
+    printf("elapsed:%.3fs throughput:%.1f matches/s %.0f ticks/s\n", seconds,
+           opt.matches / seconds, double(opt.matches) * opt.ticks / seconds);
+    return 0;
+}
@@ -0,0 +1,158 @@
+#ifndef TRON_TRACE_H
+#define TRON_TRACE_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+// Phase tracing for the server tick. Built with TRACE=1, TRACE_SCOPE records
+// a complete event (name, start, duration) into a ring owned by the calling
+// thread: one relaxed store per field and a release store of the count, no
+// locks and no allocation. SIGUSR1 asks for a dump, which the main loop writes
+// as Chrome trace event JSON (chrome://tracing, Perfetto). A dump racing a
+// thread that is wrapping its ring may show a few torn events; that is the
+// price of never stalling the writer. Without TRACE=1 every call compiles away.
+#ifdef TRON_TRACE
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <csignal>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "config.h"
+
+namespace trace {
+
+struct Event {
+    const char* name;       // string literal
+    uint64_t startUs;
+    uint64_t durUs;
+    char phase;             // 'X' complete, 'i' instant
+};
+
+struct ThreadBuffer {
+    std::atomic<uint64_t> written{0};
+    long tid = 0;
+    const char* name = nullptr;
+    Event events[TRACE_BUFFER_EVENTS];
+};
+
+inline uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBuffer*> buffers;     // never freed: exited threads stay in the trace
+};
+
+inline Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+inline std::atomic<bool>& dumpRequested() {
+    static std::atomic<bool> requested{false};
+    return requested;
+}
+
+inline ThreadBuffer& local() {
+    static thread_local ThreadBuffer* buffer = [] {
+        ThreadBuffer* b = new ThreadBuffer;
+        b->tid = syscall(SYS_gettid);
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+inline void record(const char* name, uint64_t startUs, uint64_t durUs, char phase) {
+    ThreadBuffer& b = local();
+    uint64_t n = b.written.load(std::memory_order_relaxed);
+    b.events[n % TRACE_BUFFER_EVENTS] = {name, startUs, durUs, phase};
+    b.written.store(n + 1, std::memory_order_release);
+}
+
+inline void nameThread(const char* name) { local().name = name; }
+inline void instant(const char* name) { record(name, nowUs(), 0, 'i'); }
+
+class Span {
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    explicit Span(const char* spanName) : name(spanName), start(nowUs()) {}
+    ~Span() { record(name, start, nowUs() - start, 'X'); }
+};
+
+inline void installDumpSignal() {
+    signal(SIGUSR1, [](int) { dumpRequested().store(true); });
+}
+
+// Writes the newest events of every thread; returns false if the file failed.
+inline bool dump(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+    int pid = getpid();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (ThreadBuffer* b : registry().buffers) {
+        if (b->name) {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,"
+                    "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", pid, b->tid, b->name);
+            first = false;
+        }
+        uint64_t n = b->written.load(std::memory_order_acquire);
+        uint64_t from = n > TRACE_BUFFER_EVENTS ? n - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = from; i < n; i++) {
+            const Event& e = b->events[i % TRACE_BUFFER_EVENTS];
+            fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,", first ? "" : ",\n",
+                    e.name, e.phase, (unsigned long long)e.startUs);
+            if (e.phase == 'X') {
+                fprintf(out, "\"dur\":%llu,", (unsigned long long)e.durUs);
+            } else {
+                fprintf(out, "\"s\":\"t\",");
+            }
+            fprintf(out, "\"pid\":%d,\"tid\":%ld}", pid, b->tid);
+            first = false;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+inline void dumpIfRequested(const std::string& path) {
+    if (!dumpRequested().exchange(false)) return;
+    if (dump(path.c_str())) {
+        fprintf(stderr, "Trace written to %s\n", path.c_str());
+    } else {
+        fprintf(stderr, "Could not write trace to %s\n", path.c_str());
+    }
+}
+
+}  // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) trace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+#else
+
+namespace trace {
+inline void nameThread(const char*) {}
+inline void instant(const char*) {}
+inline void installDumpSignal() {}
+inline void dumpIfRequested(const std::string&) {}
+}  // namespace trace
+
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif
+
+#endif
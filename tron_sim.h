@@ -0,0 +1,582 @@
+#ifndef TRON_SIM_H
+#define TRON_SIM_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include "config.h"
+#include "bot.h"
+#include "bitboard.h"
+#include "state_hash.h"
+
+// Socket-free game rules. A SimState is plain data; simStep advances it by one
+// tick and reports what happened as events. Time is counted in ticks of
+// tickMs, randomness comes from a seeded generator in the state, so the same
+// seed and inputs always produce the same game.
+
+constexpr int SIM_NO_PLAYER = INT_MIN;
+
+struct SimPlayer {
+    int id;              // caller-chosen identity (socket fd, bot id, ...)
+    int playerIndex;
+    int colorIndex;
+    int x, y;
+    int dx, dy;
+    bool alive;
+    int score;
+    int highScore;
+    int aliveMs;         // survival time not yet converted into score
+    uint64_t respawnTick;
+    int botLevel;        // 0 for humans
+};
+
+struct SimInput {
+    int playerId;
+    char key;
+};
+
+enum SimEventType {
+    SIM_EVENT_JOIN,
+    SIM_EVENT_LEAVE,
+    SIM_EVENT_DEATH,
+    SIM_EVENT_RESPAWN,
+};
+
+struct SimEvent {
+    SimEventType type;
+    int playerId;
+    int killerId;        // SIM_NO_PLAYER unless a DEATH was caused by another player
+    int score;           // final score on DEATH
+    int transfer;        // points awarded to the killer
+    bool newHighScore;
+};
+
+struct SimState {
+    int width = BOARD_WIDTH;
+    int height = BOARD_HEIGHT;
+    int tickMs = GAME_SPEED_MS;
+    int respawnDelayMs = RESPAWN_DELAY * 1000;
+    int survivalPoints = SCORE_SURVIVAL_TIME;   // per second alive
+    int killPoints = SCORE_KILL_POINTS;
+    double transferRate = SCORE_TRANSFER_RATE;  // share of the victim's score
+    uint64_t tick = 0;
+    uint64_t rng = 0;
+    std::vector<int> cells;
+    std::vector<SimPlayer> players;
+    std::vector<uint64_t> cellTick;             // TrailDecay only: tick each cell was laid
+    uint64_t boardHash = 0;                     // Zobrist hash of cells, kept by simSetCell
+#if USE_BITBOARD
+    Bitboard occupied;
+    Bitboard owners[MAX_PLAYERS];
+#endif
+
+    int cell(int x, int y) const { return cells[y * width + x]; }
+};
+
+inline uint64_t simRandom(SimState& s) {
+    uint64_t z = (s.rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline int simRandomInt(SimState& s, int lo, int hi) {
+    return lo + static_cast<int>(simRandom(s) % static_cast<uint64_t>(hi - lo + 1));
+}
+
+inline void simInit(SimState& s, uint64_t seed, int width = BOARD_WIDTH, int height = BOARD_HEIGHT) {
+    s.width = width;
+    s.height = height;
+    s.tick = 0;
+    s.rng = seed;
+    s.cells.assign(static_cast<size_t>(width) * height, 0);
+    s.players.clear();
+    s.cellTick.clear();
+    s.boardHash = 0;
+#if USE_BITBOARD
+    s.occupied.resize(width, height);
+    for (auto& plane : s.owners) {
+        plane.resize(width, height);
+    }
+#endif
+}
+
+inline void simSetCell(SimState& s, int x, int y, int value) {
+    size_t index = static_cast<size_t>(y) * s.width + x;
+    int& cell = s.cells[index];
+    s.boardHash ^= zobristCell(index, cell) ^ zobristCell(index, value);
+#if USE_BITBOARD
+    if (cell > 0) {
+        s.owners[cell - 1].reset(x, y);
+        s.occupied.reset(x, y);
+    }
+    if (value > 0) {
+        s.owners[value - 1].set(x, y);
+        s.occupied.set(x, y);
+    }
+#endif
+    cell = value;
+}
+
+inline SimPlayer* simFindPlayer(SimState& s, int id) {
+    for (auto& p : s.players) {
+        if (p.id == id) return &p;
+    }
+    return nullptr;
+}
+
+inline bool simIsSafePosition(const SimState& s, int x, int y) {
+#if USE_BITBOARD
+    return s.occupied.windowEmpty(x - INIT_SPACE_CHECK, y - INIT_SPACE_CHECK,
+                                  x + INIT_SPACE_CHECK, y + INIT_SPACE_CHECK);
+#else
+    for (int i = -INIT_SPACE_CHECK; i <= INIT_SPACE_CHECK; i++) {
+        for (int j = -INIT_SPACE_CHECK; j <= INIT_SPACE_CHECK; j++) {
+            int checkX = x + i;
+            int checkY = y + j;
+            if (checkX >= 0 && checkX < s.width &&
+                checkY >= 0 && checkY < s.height &&
+                s.cell(checkX, checkY) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+#endif
+}
+
+inline bool simFindSpawn(SimState& s, int& x, int& y, int& dx, int& dy) {
+    for (int attempts = 0; attempts < 100; attempts++) {
+        int cx = simRandomInt(s, INIT_SPACE_CHECK, s.width - INIT_SPACE_CHECK - 1);
+        int cy = simRandomInt(s, INIT_SPACE_CHECK, s.height - INIT_SPACE_CHECK - 1);
+        if (simIsSafePosition(s, cx, cy)) {
+            static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+            int dir = simRandomInt(s, 0, 3);
+            x = cx;
+            y = cy;
+            dx = dirs[dir][0];
+            dy = dirs[dir][1];
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void simClearTrail(SimState& s, int colorIndex) {
+#if USE_BITBOARD
+    Bitboard& trail = s.owners[colorIndex];
+    trail.forEachSet([&s, colorIndex](int x, int y) {
+        size_t index = static_cast<size_t>(y) * s.width + x;
+        s.boardHash ^= zobristCell(index, colorIndex + 1);
+        s.cells[index] = 0;
+    });
+    s.occupied.andNot(trail);
+    trail.clear();
+#else
+    for (size_t i = 0; i < s.cells.size(); i++) {
+        if (s.cells[i] == colorIndex + 1) {
+            s.boardHash ^= zobristCell(i, colorIndex + 1);
+            s.cells[i] = 0;
+        }
+    }
+#endif
+}
+
+// The whole room: board hash, clock, generator, rule settings and every
+// player record in order. Two builds that agree on this tick for tick played
+// the same game.
+inline uint64_t simHash(const SimState& s) {
+    uint64_t h = hashMix(s.boardHash ^ s.tick);
+    auto mix = [&h](uint64_t v) { h = hashMix(h ^ v) + 0x9E3779B97F4A7C15ULL; };
+    uint64_t rateBits;
+    memcpy(&rateBits, &s.transferRate, sizeof(rateBits));
+    mix(s.rng);
+    mix(static_cast<uint64_t>(s.width) << 32 | static_cast<uint32_t>(s.height));
+    mix(static_cast<uint64_t>(s.tickMs) << 32 | static_cast<uint32_t>(s.respawnDelayMs));
+    mix(static_cast<uint64_t>(s.survivalPoints) << 32 | static_cast<uint32_t>(s.killPoints));
+    mix(rateBits);
+    for (const auto& p : s.players) {
+        mix(static_cast<uint64_t>(p.id) << 32 | static_cast<uint32_t>(p.colorIndex));
+        mix(static_cast<uint64_t>(p.x) << 32 | static_cast<uint32_t>(p.y));
+        mix(static_cast<uint64_t>(p.dx + 2) << 32 | static_cast<uint32_t>(p.dy + 2));
+        mix(static_cast<uint64_t>(p.score) << 32 | static_cast<uint32_t>(p.highScore));
+        mix(static_cast<uint64_t>(p.aliveMs) << 32 | static_cast<uint32_t>(p.playerIndex));
+        mix(p.respawnTick ^ (static_cast<uint64_t>(p.alive) << 63));
+        mix(static_cast<uint64_t>(p.botLevel));
+    }
+    return h;
+}
+
+// Adds a player in the first free slot and colour. Returns nullptr when the
+// room is full or no safe spawn exists.
+inline SimPlayer* simAddPlayer(SimState& s, int id, int highScore, int botLevel,
+                               std::vector<SimEvent>& events) {
+    if (static_cast<int>(s.players.size()) >= MAX_PLAYERS) return nullptr;
+    bool usedIndex[MAX_PLAYERS] = {};
+    bool usedColor[MAX_PLAYERS] = {};
+    for (const auto& p : s.players) {
+        usedIndex[p.playerIndex] = true;
+        usedColor[p.colorIndex] = true;
+    }
+    int playerIndex = 0, colorIndex = 0;
+    while (usedIndex[playerIndex]) playerIndex++;
+    while (usedColor[colorIndex]) colorIndex++;
+
+    SimPlayer p = {};
+    if (!simFindSpawn(s, p.x, p.y, p.dx, p.dy)) return nullptr;
+    p.id = id;
+    p.playerIndex = playerIndex;
+    p.colorIndex = colorIndex;
+    p.alive = true;
+    p.highScore = highScore;
+    p.botLevel = botLevel;
+    s.players.push_back(p);
+    simSetCell(s, p.x, p.y, colorIndex + 1);
+    events.push_back({SIM_EVENT_JOIN, id, SIM_NO_PLAYER, 0, 0, false});
+    return &s.players.back();
+}
+
+inline bool simRemovePlayer(SimState& s, int id, std::vector<SimEvent>& events) {
+    auto it = std::find_if(s.players.begin(), s.players.end(),
+        [id](const SimPlayer& p) { return p.id == id; });
+    if (it == s.players.end()) return false;
+    simClearTrail(s, it->colorIndex);
+    events.push_back({SIM_EVENT_LEAVE, id, SIM_NO_PLAYER, it->score, 0, false});
+    s.players.erase(it);
+    return true;
+}
+
+inline void simApplyInput(SimPlayer& player, char input) {
+    switch(input) {
+        case KEY_UP:    if (player.dy != 1)  { player.dx = 0; player.dy = -1; } break;
+        case KEY_DOWN:  if (player.dy != -1) { player.dx = 0; player.dy = 1; }  break;
+        case KEY_LEFT:  if (player.dx != 1)  { player.dx = -1; player.dy = 0; } break;
+        case KEY_RIGHT: if (player.dx != -1) { player.dx = 1; player.dy = 0; }  break;
+    }
+}
+
+// Rule policies. A room's rules are a SimRules bundle fixed at compile time,
+// so simStep<Rules> carries no mode flags. ClassicRules plays the original
+// game, except that due respawns land before the tick's moves rather than
+// between them.
+
+// Edges: adjust a step that leaves the board; false means the player crashed.
+struct WallEdges {
+    static constexpr bool wraps = false;
+    static bool step(const SimState& s, int& x, int& y) {
+        return x >= 0 && x < s.width && y >= 0 && y < s.height;
+    }
+};
+
+struct WrapEdges {
+    static constexpr bool wraps = true;
+    static bool step(const SimState& s, int& x, int& y) {
+        x = (x + s.width) % s.width;
+        y = (y + s.height) % s.height;
+        return true;
+    }
+};
+
+// Own trail: pass through it, or crash into it.
+struct SelfPassThrough {
+    static constexpr bool collides = false;
+};
+
+struct SelfCollides {
+    static constexpr bool collides = true;
+};
+
+// Trails either stay until death or fade TRAIL_DECAY_TICKS after being laid.
+struct NoTrailDecay {
+    static void laid(SimState&, int, int) {}
+    static void decay(SimState&) {}
+};
+
+struct TrailDecay {
+    static void laid(SimState& s, int x, int y) {
+        if (s.cellTick.size() != s.cells.size()) s.cellTick.assign(s.cells.size(), s.tick);
+        s.cellTick[y * s.width + x] = s.tick;
+    }
+
+    static void decay(SimState& s) {
+        if (s.cellTick.size() != s.cells.size()) s.cellTick.assign(s.cells.size(), s.tick);
+        for (int y = 0; y < s.height; y++) {
+            for (int x = 0; x < s.width; x++) {
+                int i = y * s.width + x;
+                if (!s.cells[i] || s.tick - s.cellTick[i] < TRAIL_DECAY_TICKS) continue;
+                bool head = false;
+                for (const auto& p : s.players) {
+                    head |= p.alive && p.x == x && p.y == y;
+                }
+                if (!head) simSetCell(s, x, y, 0);
+            }
+        }
+    }
+};
+
+// Scoring: points for staying alive and what a kill pays the killer.
+struct ClassicScoring {
+    static void alive(const SimState& s, SimPlayer& player) {
+        player.aliveMs += s.tickMs;
+        while (player.aliveMs >= 1000) {
+            player.score += s.survivalPoints;
+            player.aliveMs -= 1000;
+        }
+    }
+
+    static int killReward(const SimState& s, int victimScore) {
+        return s.killPoints + static_cast<int>(victimScore * s.transferRate);
+    }
+};
+
+struct KillScoring {
+    static void alive(const SimState&, SimPlayer&) {}
+    static int killReward(const SimState& s, int) { return s.killPoints; }
+};
+
+// Respawn: after the respawn delay, or only once a round is down to one survivor.
+struct DelayedRespawn {
+    static constexpr bool needsAliveCount = false;
+    static bool due(const SimState& s, const SimPlayer& player, int) {
+        return s.tick >= player.respawnTick;
+    }
+};
+
+struct RoundRespawn {
+    static constexpr bool needsAliveCount = true;
+    static bool due(const SimState& s, const SimPlayer& player, int alive) {
+        return alive <= 1 && s.tick >= player.respawnTick;
+    }
+};
+
+template <class EdgePolicy, class SelfPolicy, class DecayPolicy, class ScoringPolicy,
+          class RespawnPolicy>
+struct SimRules {
+    using Edges = EdgePolicy;
+    using Self = SelfPolicy;
+    using Decay = DecayPolicy;
+    using Scoring = ScoringPolicy;
+    using Respawn = RespawnPolicy;
+};
+
+using ClassicRules = SimRules<WallEdges, SelfPassThrough, NoTrailDecay, ClassicScoring, 
+                              DelayedRespawn>;
+using WrapRules = SimRules<WrapEdges, SelfPassThrough, NoTrailDecay, ClassicScoring, 
+                           DelayedRespawn>;
+using DecayRules = SimRules<WallEdges, SelfCollides, TrailDecay, ClassicScoring, 
+                            DelayedRespawn>;
+using RoundsRules = SimRules<WallEdges, SelfCollides, NoTrailDecay, KillScoring, 
+                             RoundRespawn>;
+
+// Moves (x, y) through the edge policy; false when the step is a crash.
+template <class Rules>
+inline bool simCheckCollision(SimState& s, int& x, int& y, const SimPlayer& player,
+                              SimPlayer** killer) {
+    if (!Rules::Edges::step(s, x, y)) {
+        return true;
+    }
+    int cell = s.cell(x, y);
+    if (cell != 0) {
+        int killerColorIndex = cell - 1;
+        if (killerColorIndex == player.colorIndex) {
+            return Rules::Self::collides;
+        }
+        for (auto& p : s.players) {
+            if (p.colorIndex == killerColorIndex) {
+                *killer = &p;
+                break;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+template <class Rules>
+inline void simKill(SimState& s, SimPlayer& player, SimPlayer* killer,
+                    std::vector<SimEvent>& events) {
+    int finalScore = player.score;
+    bool newHigh = finalScore > player.highScore;
+    if (newHigh) {
+        player.highScore = finalScore;
+    }
+
+    SimEvent event = {SIM_EVENT_DEATH, player.id, SIM_NO_PLAYER, finalScore, 0, newHigh};
+    if (killer != nullptr && killer != &player && killer->alive) {
+        event.killerId = killer->id;
+        event.transfer = Rules::Scoring::killReward(s, finalScore);
+        killer->score += event.transfer;
+    }
+    events.push_back(event);
+
+    player.alive = false;
+    player.score = 0;
+    player.aliveMs = 0;
+    player.respawnTick = s.tick + (s.respawnDelayMs + s.tickMs - 1) / s.tickMs;
+    simClearTrail(s, player.colorIndex);
+}
+
+inline void simRespawn(SimState& s, SimPlayer& player, std::vector<SimEvent>& events) {
+    int x, y, dx, dy;
+    if (!simFindSpawn(s, x, y, dx, dy)) return;
+    simClearTrail(s, player.colorIndex);
+    player.x = x;
+    player.y = y;
+    player.dx = dx;
+    player.dy = dy;
+    player.alive = true;
+    player.score = 0;
+    player.aliveMs = 0;
+    simSetCell(s, x, y, player.colorIndex + 1);
+    events.push_back({SIM_EVENT_RESPAWN, player.id, SIM_NO_PLAYER, 0, 0, false});
+}
+
+// Advances the game one tick: inputs are applied in order, due respawns
+// happen, survival score accrues, then every living player moves once in
+// join order. A player respawned this tick only appears; it scores and moves
+// from the next tick. Returns whether anything visible changed.
+template <class Rules = ClassicRules>
+inline bool simStep(SimState& s, const SimInput* inputs, size_t inputCount,
+                    std::vector<SimEvent>& events) {
+    for (size_t i = 0; i < inputCount; i++) {
+        SimPlayer* p = simFindPlayer(s, inputs[i].playerId);
+        if (p && p->alive) simApplyInput(*p, inputs[i].key);
+    }
+
+    bool changed = false;
+    int alive = 0;
+    if constexpr (Rules::Respawn::needsAliveCount) {
+        for (const auto& player : s.players) alive += player.alive;
+    }
+    bool respawned[MAX_PLAYERS] = {};
+    for (auto& player : s.players) {
+        if (!player.alive && Rules::Respawn::due(s, player, alive)) {
+            simRespawn(s, player, events);
+            respawned[player.colorIndex] = player.alive;
+            changed = true;
+        }
+    }
+
+    for (auto& player : s.players) {
+        if (!player.alive || respawned[player.colorIndex]) continue;
+        Rules::Scoring::alive(s, player);
+    }
+
+    for (auto& player : s.players) {
+        if (!player.alive || respawned[player.colorIndex]) continue;
+        int newX = player.x + player.dx;
+        int newY = player.y + player.dy;
+
+        SimPlayer* killer = nullptr;
+        bool willCollide = simCheckCollision<Rules>(s, newX, newY, player, &killer);
+        simSetCell(s, player.x, player.y, player.colorIndex + 1);
+        Rules::Decay::laid(s, player.x, player.y);
+        changed = true;
+        if (willCollide) {
+            simKill<Rules>(s, player, killer, events);
+            continue;
+        }
+        player.x = newX;
+        player.y = newY;
+        simSetCell(s, player.x, player.y, player.colorIndex + 1);
+        Rules::Decay::laid(s, player.x, player.y);
+    }
+    Rules::Decay::decay(s);
+
+    s.tick++;
+    return changed;
+}
+
+// Produces bot inputs for a state. Levels map to search depth (see
+// BotPlanner); with a non-zero budget, bots decided after the tick has spent
+// budgetUs drop to BOT_LEVEL_EASY, which keeps cost bounded but makes the
+// result timing dependent, so batch runs leave the budget at zero. Bots plan
+// under the room's rules: which trails they may cross and whether the edges
+// wrap.
+template <class Rules>
+class SimBotDriver {
+public:
+    struct Stats {
+        uint64_t ticks;
+        uint64_t decisions;
+        uint64_t degraded;
+        uint64_t totalUs;
+        uint64_t maxTickUs;
+    };
+
+private:
+    TerritoryEvaluator<Rules> territory;
+    BotPlanner<TerritoryEvaluator<Rules>> planner{territory};
+#if USE_BITBOARD
+    // Reachable-area scoring runs on the bitboards (scanline fill at word
+    // width), except on wrapping boards, which the fill does not cross.
+    // Voronoi levels always use the cell BFS.
+    static constexpr bool bitboardEasy = !Rules::Edges::wraps;
+    BitboardEvaluator<Rules> bitTerritory;
+    BotPlanner<BitboardEvaluator<Rules>> easyPlanner{bitTerritory};
+#else
+    static constexpr bool bitboardEasy = false;
+    BotPlanner<TerritoryEvaluator<Rules>>& easyPlanner = planner;
+#endif
+    std::vector<BotHead> heads;
+    Stats stats = {};
+
+public:
+    const Stats& getStats() const { return stats; }
+
+    // Appends one input per bot that wants to turn; returns the microseconds spent.
+    uint64_t decide(const SimState& s, std::vector<SimInput>& out, uint64_t budgetUs = 0) {
+        heads.clear();
+        for (const auto& p : s.players) {
+            if (p.alive) heads.push_back({p.x, p.y, p.colorIndex + 1});
+        }
+        if (heads.empty()) return 0;
+
+        bool loaded = false;
+        auto tickStart = std::chrono::steady_clock::now();
+        uint64_t spentUs = 0;
+        for (const auto& p : s.players) {
+            if (!p.botLevel || !p.alive) continue;
+            if (!loaded) {
+                territory.load(s.cells.data(), s.width, s.height);
+#if USE_BITBOARD
+                if constexpr (bitboardEasy) bitTerritory.load(s.occupied, s.owners, MAX_PLAYERS);
+#endif
+                loaded = true;
+            }
+            int self = 0;
+            while (heads[self].value != p.colorIndex + 1) self++;
+            int level = p.botLevel;
+            if (budgetUs && spentUs >= budgetUs) {
+                level = BOT_LEVEL_EASY;
+                stats.degraded++;
+            }
+            char key;
+            if (level <= BOT_LEVEL_EASY && bitboardEasy) {
+                easyPlanner.setHeads(heads, self);
+                key = easyPlanner.chooseMove(p.dx, p.dy, level);
+            } else {
+                planner.setHeads(heads, self);
+                key = planner.chooseMove(p.dx, p.dy, level);
+            }
+            if (key) out.push_back({p.id, key});
+            stats.decisions++;
+            if (budgetUs) {
+                spentUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - tickStart).count();
+            }
+        }
+        if (!loaded) return 0;
+        spentUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - tickStart).count();
+        stats.ticks++;
+        stats.totalUs += spentUs;
+        stats.maxTickUs = std::max(stats.maxTickUs, spentUs);
+        return spentUs;
+    }
+};
+
+#endif
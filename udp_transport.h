@@ -0,0 +1,125 @@
+#ifndef TRON_UDP_TRANSPORT_H
+#define TRON_UDP_TRANSPORT_H
+
+#include <string>
+#include <deque>
+#include <cstdint>
+#include "config.h"
+#include "protocol.h"
+
+// Datagram transport. Every packet starts with a one-byte kind:
+//   CONNECT    c->s [nonce u32][codec mask u8][player name, optional]
+//   ACCEPT     s->c [nonce u32][session u32][codecs u8][index "pi,ci"]
+//   REJECT     s->c [nonce u32]
+//   INPUT      c->s [session u32][first seq u32][count u8]{[key u8][tick u32]}...
+//   STATE      s->c [session u32][state seq u32][input ack u32][frame]
+//   DISCONNECT c->s [session u32]
+//   PING       both [session u32][ping payload]
+//   PONG       both [session u32][the PING's payload, unchanged]
+// STATE carries an ordinary MSG_STATE/MSG_COMPRESSED frame. It is sent once
+// and never retried; the client drops anything older than what it has shown.
+// INPUT repeats every unacknowledged key until a STATE acks it, so a lost
+// datagram costs one resend interval instead of a TCP retransmit timeout.
+// Each key carries the tick of the state the player was looking at, for lag
+// compensation. An INPUT with no keys doubles as the keepalive. PING and
+// PONG carry the heartbeat payload of latency.h, so a UDP session measures
+// RTT, jitter and loss the same way a TCP connection does.
+enum UdpPacketKind : uint8_t {
+    UDP_CONNECT = 1,
+    UDP_ACCEPT = 2,
+    UDP_REJECT = 3,
+    UDP_INPUT = 4,
+    UDP_STATE = 5,
+    UDP_DISCONNECT = 6,
+    UDP_PING = 7,
+    UDP_PONG = 8,
+};
+
+constexpr size_t UDP_HEADER_SIZE = 5;           // kind and session
+constexpr size_t UDP_STATE_HEADER_SIZE = 13;
+
+inline void putU32(std::string& out, uint32_t v) {
+    out.push_back(static_cast<char>((v >> 24) & 0xFF));
+    out.push_back(static_cast<char>((v >> 16) & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+inline uint32_t getU32(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | b[3];
+}
+
+inline void writeUdpHeader(char* out, UdpPacketKind kind, uint32_t session) {
+    out[0] = static_cast<char>(kind);
+    for (int i = 0; i < 4; i++) out[1 + i] = static_cast<char>(session >> (24 - 8 * i));
+}
+
+// Serial-number comparison, so sequence numbers may wrap.
+inline bool seqNewer(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+inline std::string encodeUdpStateHeader(uint32_t session, uint32_t seq, uint32_t inputAck) {
+    std::string header;
+    header.reserve(UDP_STATE_HEADER_SIZE);
+    header.push_back(static_cast<char>(UDP_STATE));
+    putU32(header, session);
+    putU32(header, seq);
+    putU32(header, inputAck);
+    return header;
+}
+
+// Splits a single encoded frame (as carried in STATE) into type and payload.
+inline bool parseFrame(const char* data, size_t length, MessageType& type,
+                       const char*& payload, size_t& payloadLength) {
+    if (length < FRAME_HEADER_SIZE) return false;
+    payloadLength = getU32(data);
+    if (payloadLength != length - FRAME_HEADER_SIZE) return false;
+    type = static_cast<MessageType>(static_cast<uint8_t>(data[4]));
+    payload = data + FRAME_HEADER_SIZE;
+    return true;
+}
+
+// Client-side window of keys not yet acknowledged by the server. Sequence
+// numbers start at 1 so an ack of 0 means nothing received yet.
+class UdpInputWindow {
+private:
+    std::deque<std::pair<char, uint32_t>> unacked;
+    uint32_t firstSeq = 1;
+
+public:
+    void push(char key, uint32_t seenTick) {
+        if (unacked.size() >= UDP_INPUT_WINDOW) {
+            unacked.pop_front();
+            firstSeq++;
+        }
+        unacked.push_back({key, seenTick});
+    }
+
+    // Drops every key with sequence <= ackSeq.
+    void ack(uint32_t ackSeq) {
+        while (!unacked.empty() && !seqNewer(firstSeq, ackSeq)) {
+            unacked.pop_front();
+            firstSeq++;
+        }
+    }
+
+    bool pending() const { return !unacked.empty(); }
+
+    std::string encode(uint32_t session) const {
+        std::string packet;
+        packet.reserve(10 + 5 * unacked.size());
+        packet.push_back(static_cast<char>(UDP_INPUT));
+        putU32(packet, session);
+        putU32(packet, firstSeq);
+        packet.push_back(static_cast<char>(unacked.size()));
+        for (const auto& [key, tick] : unacked) {
+            packet.push_back(key);
+            putU32(packet, tick);
+        }
+        return packet;
+    }
+};
+
+#endif
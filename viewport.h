@@ -0,0 +1,73 @@
+#ifndef TRON_VIEWPORT_H
+#define TRON_VIEWPORT_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include "config.h"
+
+// Interest management: a client that reports its visible board size gets only
+// the cells around its head (plus VIEWPORT_MARGIN on each side) and a coarse
+// minimap, so frame size depends on the terminal, not on the arena.
+struct ViewRect {
+    int x, y, w, h;
+};
+
+inline ViewRect viewAround(int cx, int cy, int viewW, int viewH, int boardW, int boardH) {
+    ViewRect r;
+    r.w = std::min(viewW + 2 * VIEWPORT_MARGIN, boardW);
+    r.h = std::min(viewH + 2 * VIEWPORT_MARGIN, boardH);
+    r.x = std::max(0, std::min(cx - r.w / 2, boardW - r.w));
+    r.y = std::max(0, std::min(cy - r.h / 2, boardH - r.h));
+    return r;
+}
+
+inline void minimapSize(int boardW, int boardH, int& mw, int& mh) {
+    mw = std::min(MINIMAP_WIDTH, boardW);
+    mh = std::min(MINIMAP_HEIGHT, boardH);
+}
+
+// Each minimap cell holds the trail value covering most of its block, or 0.
+inline void buildMinimap(const int* cells, int boardW, int boardH, std::vector<int>& out) {
+    int mw, mh;
+    minimapSize(boardW, boardH, mw, mh);
+    out.assign(static_cast<size_t>(mw) * mh, 0);
+    int counts[MAX_PLAYERS + 1];
+    for (int my = 0; my < mh; my++) {
+        int y0 = my * boardH / mh, y1 = (my + 1) * boardH / mh;
+        for (int mx = 0; mx < mw; mx++) {
+            int x0 = mx * boardW / mw, x1 = (mx + 1) * boardW / mw;
+            std::fill(counts, counts + MAX_PLAYERS + 1, 0);
+            for (int y = y0; y < y1; y++) {
+                const int* row = cells + static_cast<size_t>(y) * boardW;
+                for (int x = x0; x < x1; x++) {
+                    if (row[x] > 0 && row[x] <= MAX_PLAYERS) counts[row[x]]++;
+                }
+            }
+            int best = 0;
+            for (int v = 1; v <= MAX_PLAYERS; v++) {
+                if (counts[v] > counts[best]) best = v;
+            }
+            out[my * mw + mx] = best;
+        }
+    }
+}
+
+inline std::string encodeViewport(int cols, int rows) {
+    char payload[4] = {
+        static_cast<char>((cols >> 8) & 0xFF), static_cast<char>(cols & 0xFF),
+        static_cast<char>((rows >> 8) & 0xFF), static_cast<char>(rows & 0xFF)
+    };
+    return std::string(payload, 4);
+}
+
+inline bool decodeViewport(const char* data, size_t length, int& cols, int& rows) {
+    if (length < 4) return false;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    cols = (p[0] << 8) | p[1];
+    rows = (p[2] << 8) | p[3];
+    return true;
+}
+
+#endif
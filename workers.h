@@ -0,0 +1,147 @@
+#ifndef TRON_WORKERS_H
+#define TRON_WORKERS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sched.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include "config.h"
+
+// Multi-process mode (./server --workers N). Every worker binds the game port
+// with SO_REUSEPORT, so the kernel spreads new connections across them, and
+// runs exactly one room on one pinned CPU. A client that names a room sends
+// MSG_JOIN first; room ids are consistently hashed onto workers and a
+// connection accepted by the wrong worker is passed, fd and all, through the
+// parent process, which stays behind as the coordinator. Clients that name no
+// room play wherever the kernel put them.
+//
+// Worker <-> coordinator channel (SOCK_SEQPACKET): one message per connection,
+//   [u32 room BE] with the client socket attached as SCM_RIGHTS.
+namespace workers {
+
+// Jump consistent hash (Lamping & Veach): a room keeps its worker when the
+// worker count changes unless it has to move to a new one.
+inline int roomOwner(uint64_t room, int workerCount) {
+    int64_t b = -1, j = 0;
+    while (j < workerCount) {
+        b = j;
+        room = room * 2862933555777941757ULL + 1;
+        j = static_cast<int64_t>((b + 1) * (double(1LL << 31) / double((room >> 33) + 1)));
+    }
+    return static_cast<int>(b);
+}
+
+// Per-worker name for files and shm segments; worker 0 keeps the plain one so
+// single-process tools (spectators, score files) still find it.
+inline std::string workerPath(const char* base, int worker) {
+    return worker > 0 ? std::string(base) + "." + std::to_string(worker) : base;
+}
+
+inline bool pinToCpu(int worker) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+    int cpus = CPU_COUNT(&allowed);
+    if (cpus <= 0) return false;
+    int want = worker % cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || want--) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        return sched_setaffinity(0, sizeof(one), &one) == 0;
+    }
+    return false;
+#else
+    (void)worker;
+    return false;
+#endif
+}
+
+inline bool sendRouted(int channel, int fd, uint32_t room) {
+    char payload[4] = {
+        static_cast<char>((room >> 24) & 0xFF),
+        static_cast<char>((room >> 16) & 0xFF),
+        static_cast<char>((room >> 8) & 0xFF),
+        static_cast<char>(room & 0xFF)
+    };
+    struct iovec iov = {payload, sizeof(payload)};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(channel, &msg, MSG_NOSIGNAL) == sizeof(payload);
+}
+
+// Returns false when the channel is closed or the message carried no socket.
+inline bool recvRouted(int channel, int& fd, uint32_t& room) {
+    unsigned char payload[4];
+    struct iovec iov = {payload, sizeof(payload)};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(channel, &msg, 0) != sizeof(payload)) return false;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return false;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    room = (uint32_t(payload[0]) << 24) | (uint32_t(payload[1]) << 16) |
+           (uint32_t(payload[2]) << 8) | payload[3];
+    return true;
+}
+
+// Coordinator loop in the parent: forwards routed connections to the owning
+// worker until every worker has exited.
+inline int coordinate(std::vector<int>& channels, std::vector<pid_t>& pids) {
+    int workerCount = static_cast<int>(channels.size());
+    int running = workerCount;
+    std::vector<struct pollfd> fds(workerCount);
+    while (running > 0) {
+        for (int w = 0; w < workerCount; w++) {
+            fds[w] = {channels[w], POLLIN, 0};
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int w = 0; w < workerCount; w++) {
+            if (channels[w] < 0 || !fds[w].revents) continue;
+            int fd;
+            uint32_t room;
+            if (!recvRouted(channels[w], fd, room)) {
+                std::cerr << "Worker " << w << " exited" << std::endl;
+                close(channels[w]);
+                channels[w] = -1;
+                waitpid(pids[w], nullptr, 0);
+                running--;
+                continue;
+            }
+            int owner = roomOwner(room, workerCount);
+            if (channels[owner] < 0 || !sendRouted(channels[owner], fd, room)) {
+                std::cerr << "Room " << room << " has no worker, dropping client" << std::endl;
+            }
+            close(fd);
+        }
+    }
+    return running ? 1 : 0;
+}
+
+}  // namespace workers
+
+#endif